@@ -30,6 +30,7 @@ struct memory_blob_pool * memory_blob_pool_create(size_t blob_size, size_t align
     }
     memset(pool, 0, sizeof(struct memory_blob_pool));
     pool->blob_size = blob_size;
+    pool->next_blob_size = blob_size;
     pool->alignment = alignment;
     pool->blob_capacity = DEFAULT_MEMORY_BLOB_CAPACITY;
     pool->blobs = malloc(sizeof(struct memory_blob *) * pool->blob_capacity);
@@ -45,6 +46,7 @@ void memory_blob_pool_init(struct memory_blob_pool * pool, size_t blob_size, siz
 
     memset(pool, 0, sizeof(struct memory_blob_pool));
     pool->blob_size = blob_size;
+    pool->next_blob_size = blob_size;
     pool->alignment = alignment;
     pool->blob_capacity = DEFAULT_MEMORY_BLOB_CAPACITY;
     pool->blobs = malloc(sizeof(struct memory_blob *) * pool->blob_capacity);
@@ -53,42 +55,134 @@ void memory_blob_pool_init(struct memory_blob_pool * pool, size_t blob_size, siz
     }
 }
 
-void * memory_blob_pool_alloc(struct memory_blob_pool * pool, size_t size)
+static void push_blob(struct memory_blob *** blobs, size_t * count, size_t * capacity, struct memory_blob * blob)
 {
-    assert(pool != NULL);
+    if (*count >= *capacity) {
+        *capacity = *capacity > 0 ? *capacity * 2 : DEFAULT_MEMORY_BLOB_CAPACITY;
+        struct memory_blob ** new_blobs = realloc(*blobs, sizeof(struct memory_blob *) * *capacity);
+        if (new_blobs == NULL) {
+            cclynx_fatal_error("ERROR: failed to reallocate memory blob pool entries\n");
+        }
+        *blobs = new_blobs;
+    }
+
+    (*blobs)[(*count)++] = blob;
+}
+
+static void free_blob(struct memory_blob * blob)
+{
+    free(blob->memory);
+    free(blob);
+}
+
+static void track_reserved(struct memory_blob_pool * pool, size_t capacity)
+{
+    pool->stats.blob_count++;
+    pool->stats.reserved += capacity;
+    if (pool->stats.reserved > pool->stats.peak_reserved) {
+        pool->stats.peak_reserved = pool->stats.reserved;
+    }
+}
+
+static void release_large_blobs(struct memory_blob_pool * pool, size_t keep_count)
+{
+    for (size_t i = keep_count; i < pool->large_blob_count; ++i) {
+        pool->stats.reserved -= pool->large_blobs[i]->capacity;
+        free_blob(pool->large_blobs[i]);
+    }
+
+    pool->large_blob_count = keep_count;
+}
+
+static void * alloc_large(struct memory_blob_pool * pool, size_t aligned_size)
+{
+    struct memory_blob * blob = alloc_new_blob(aligned_size);
+    blob->used = aligned_size;
+    blob->dirty = aligned_size;
+    push_blob(&pool->large_blobs, &pool->large_blob_count, &pool->large_blob_capacity, blob);
+    track_reserved(pool, aligned_size);
+    pool->stats.used += aligned_size;
+    return blob->memory;
+}
+
+static void * take_from_blob(struct memory_blob_pool * pool, struct memory_blob * blob, size_t offset, size_t size)
+{
+    void * ptr = (char *)blob->memory + offset;
+    size_t end = offset + size;
 
+    /* callers expect zeroed memory, so clear whatever a previous user left behind */
+    if (offset < blob->dirty) {
+        memset(ptr, 0, (end < blob->dirty ? end : blob->dirty) - offset);
+    }
+    if (end > blob->dirty) {
+        blob->dirty = end;
+    }
+
+    pool->stats.used += end - blob->used;
+    blob->used = end;
+    return ptr;
+}
+
+static void * alloc_from_pool(struct memory_blob_pool * pool, size_t size)
+{
     size_t aligned_size = align_up(size, pool->alignment);
 
     if (pool->blob_count > 0) {
-        struct memory_blob * blob = pool->blobs[pool->blob_count - 1];
+        struct memory_blob * blob = pool->blobs[pool->current_blob];
         size_t aligned_offset = align_up(blob->used, pool->alignment);
 
         if (aligned_offset + aligned_size <= blob->capacity) {
-            void * ptr = (char *)blob->memory + aligned_offset;
-            blob->used = aligned_offset + aligned_size;
-            return ptr;
+            return take_from_blob(pool, blob, aligned_offset, aligned_size);
         }
     }
 
-    if (pool->blob_count >= pool->blob_capacity) {
-        pool->blob_capacity *= 2;
-        struct memory_blob ** new_blobs = realloc(pool->blobs, sizeof(struct memory_blob *) * pool->blob_capacity);
-        if (new_blobs == NULL) {
-            cclynx_fatal_error("ERROR: failed to reallocate memory blob pool entries\n");
+    if (aligned_size > pool->next_blob_size / LARGE_ALLOCATION_DIVISOR) {
+        return alloc_large(pool, aligned_size);
+    }
+
+    if (pool->current_blob + 1 < pool->blob_count) {
+        struct memory_blob * blob = pool->blobs[pool->current_blob + 1];
+
+        /* retained blobs are smaller the earlier they were opened */
+        if (aligned_size > blob->capacity) {
+            return alloc_large(pool, aligned_size);
         }
-        pool->blobs = new_blobs;
+
+        ++pool->current_blob;
+        return take_from_blob(pool, blob, 0, aligned_size);
     }
 
-    if (aligned_size > pool->blob_size) {
-        cclynx_fatal_error("ERROR: allocation of %zu bytes exceeds blob size of %zu bytes\n", size, pool->blob_size);
+    struct memory_blob * new_blob = alloc_new_blob(pool->next_blob_size);
+    push_blob(&pool->blobs, &pool->blob_count, &pool->blob_capacity, new_blob);
+    pool->current_blob = pool->blob_count - 1;
+    track_reserved(pool, new_blob->capacity);
+
+    if (pool->next_blob_size < MAX_MEMORY_BLOB_SIZE) {
+        pool->next_blob_size *= 2;
     }
 
-    struct memory_blob * new_blob = alloc_new_blob(pool->blob_size);
-    pool->blobs[pool->blob_count++] = new_blob;
+    return take_from_blob(pool, new_blob, 0, aligned_size);
+}
+
+void * memory_blob_pool_alloc(struct memory_blob_pool * pool, size_t size)
+{
+    return memory_blob_pool_alloc_tagged(pool, size, MEMORY_TAG_OTHER);
+}
+
+void * memory_blob_pool_alloc_tagged(struct memory_blob_pool * pool, size_t size, enum memory_tag tag)
+{
+    assert(pool != NULL);
+    assert(tag < MEMORY_TAG_COUNT);
 
-    size_t aligned_offset = align_up(new_blob->used, pool->alignment);
-    void * ptr = (char *)new_blob->memory + aligned_offset;
-    new_blob->used = aligned_offset + aligned_size;
+    size_t used_before = pool->stats.used;
+    void * ptr = alloc_from_pool(pool, size);
+
+    pool->stats.requested[tag] += size;
+    pool->stats.padding[tag] += pool->stats.used - used_before - size;
+    pool->stats.allocations[tag]++;
+    if (pool->stats.used > pool->stats.peak_used) {
+        pool->stats.peak_used = pool->stats.used;
+    }
 
     return ptr;
 }
@@ -98,12 +192,113 @@ void memory_blob_pool_free(struct memory_blob_pool * pool, bool free_pool)
     assert(pool != NULL);
 
     for (size_t i = 0; i < pool->blob_count; ++i) {
-        free(pool->blobs[i]->memory);
-        free(pool->blobs[i]);
+        free_blob(pool->blobs[i]);
+    }
+
+    for (size_t i = 0; i < pool->large_blob_count; ++i) {
+        free_blob(pool->large_blobs[i]);
     }
 
     free(pool->blobs);
+    free(pool->large_blobs);
 
     if (free_pool)
         free(pool);
 }
+
+/*
+ * Drops every allocation but keeps the regular blobs, so the next
+ * compilation reuses memory that is already mapped instead of going back
+ * to malloc. Large allocations are returned to the system.
+ */
+void memory_blob_pool_reset(struct memory_blob_pool * pool)
+{
+    assert(pool != NULL);
+
+    for (size_t i = 0; i < pool->blob_count; ++i) {
+        pool->blobs[i]->used = 0;
+    }
+
+    release_large_blobs(pool, 0);
+    pool->current_blob = 0;
+    pool->stats.used = 0;
+}
+
+struct memory_blob_pool_mark memory_blob_pool_mark(const struct memory_blob_pool * pool)
+{
+    assert(pool != NULL);
+
+    struct memory_blob_pool_mark mark;
+    mark.blob_index = pool->current_blob;
+    mark.used = pool->blob_count > 0 ? pool->blobs[pool->current_blob]->used : 0;
+    mark.large_blob_count = pool->large_blob_count;
+    mark.pool_used = pool->stats.used;
+    return mark;
+}
+
+/*
+ * Releases everything allocated since the mark was taken. The mark must
+ * come from this pool and not be older than a reset or an earlier rewind
+ * past it.
+ */
+void memory_blob_pool_rewind(struct memory_blob_pool * pool, struct memory_blob_pool_mark mark)
+{
+    assert(pool != NULL);
+    assert(mark.blob_index <= pool->current_blob);
+    assert(mark.large_blob_count <= pool->large_blob_count);
+
+    release_large_blobs(pool, mark.large_blob_count);
+    pool->stats.used = mark.pool_used;
+
+    if (pool->blob_count == 0) {
+        return;
+    }
+
+    for (size_t i = mark.blob_index + 1; i <= pool->current_blob; ++i) {
+        pool->blobs[i]->used = 0;
+    }
+
+    assert(mark.used <= pool->blobs[mark.blob_index]->used);
+    pool->blobs[mark.blob_index]->used = mark.used;
+    pool->current_blob = mark.blob_index;
+}
+
+const char * memory_tag_name(enum memory_tag tag)
+{
+    switch (tag) {
+        case MEMORY_TAG_OTHER: return "other";
+        case MEMORY_TAG_TOKENS: return "tokens";
+        case MEMORY_TAG_IDENTIFIERS: return "identifiers";
+        case MEMORY_TAG_HASHMAP: return "hashmap";
+        case MEMORY_TAG_AST: return "ast";
+        case MEMORY_TAG_SYMBOLS: return "symbols";
+        case MEMORY_TAG_IR_INSTRUCTIONS: return "ir instructions";
+        case MEMORY_TAG_IR_OPERANDS: return "ir operands";
+        case MEMORY_TAG_CFG: return "cfg";
+        case MEMORY_TAG_ERRORS: return "errors";
+        case MEMORY_TAG_COUNT: break;
+    }
+    return "unknown";
+}
+
+/*
+ * Sums the statistics of pools that were alive at the same time, so the
+ * peaks add up as well.
+ */
+void memory_blob_pool_stats_merge(struct memory_blob_pool_stats * target, const struct memory_blob_pool_stats * source)
+{
+    assert(target != NULL);
+    assert(source != NULL);
+
+    for (size_t i = 0; i < MEMORY_TAG_COUNT; ++i) {
+        target->requested[i] += source->requested[i];
+        target->padding[i] += source->padding[i];
+        target->allocations[i] += source->allocations[i];
+    }
+
+    target->blob_count += source->blob_count;
+    target->used += source->used;
+    target->peak_used += source->peak_used;
+    target->reserved += source->reserved;
+    target->peak_reserved += source->peak_reserved;
+}
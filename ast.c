@@ -6,16 +6,83 @@
 #include "type.h"
 #include "error.h"
 
+#define ast_content_size(member) (sizeof(((struct ast_node *)0)->content.member))
+
+static const size_t ast_content_sizes[] = {
+    [AST_NODE_KIND_TRANSLATION_UNIT] =              ast_content_size(translation_unit),
+    [AST_NODE_KIND_VARIABLE_DECLARATION] =          ast_content_size(symbol),
+    [AST_NODE_KIND_FUNCTION_PARAMETER] =            ast_content_size(symbol),
+    [AST_NODE_KIND_FUNCTION_DEFINITION] =           ast_content_size(function_definition),
+    [AST_NODE_KIND_COMPOUND_STATEMENT] =            ast_content_size(list),
+    [AST_NODE_KIND_EXPRESSION_STATEMENT] =          ast_content_size(node),
+    [AST_NODE_KIND_WHILE_STATEMENT] =               ast_content_size(while_statement),
+    [AST_NODE_KIND_RETURN_STATEMENT] =              ast_content_size(node),
+    [AST_NODE_KIND_IF_STATEMENT] =                  ast_content_size(if_statement),
+    [AST_NODE_KIND_INTEGER_CONSTANT_EXPRESSION] =   ast_content_size(constant),
+    [AST_NODE_KIND_VARIABLE_EXPRESSION] =           ast_content_size(symbol),
+    [AST_NODE_KIND_FUNCTION_CALL_EXPRESSION] =      ast_content_size(function_call),
+    [AST_NODE_KIND_CAST_EXPRESSION] =               ast_content_size(node),
+    [AST_NODE_KIND_ASSIGNMENT_EXPRESSION] =         ast_content_size(assignment),
+    [AST_NODE_KIND_MULTIPLICATIVE_EXPRESSION] =     ast_content_size(binary_expression),
+    [AST_NODE_KIND_ADDITIVE_EXPRESSION] =           ast_content_size(binary_expression),
+    [AST_NODE_KIND_RELATIONAL_EXPRESSION] =         ast_content_size(binary_expression),
+    [AST_NODE_KIND_EQUALITY_EXPRESSION] =           ast_content_size(binary_expression),
+};
+
+size_t ast_node_size(enum ast_node_kind kind)
+{
+    assert(kind > 0 && (size_t)kind < sizeof(ast_content_sizes) / sizeof(ast_content_sizes[0]));
+    return offsetof(struct ast_node, content) + ast_content_sizes[kind];
+}
+
 struct ast_node * ast_create_node(struct memory_blob_pool * pool, enum ast_node_kind kind, struct type * type)
 {
     assert(pool != NULL);
     assert(type != NULL);
-    struct ast_node * node = memory_blob_pool_alloc(pool, sizeof(struct ast_node));
+    struct ast_node * node = memory_blob_pool_alloc_tagged(pool, ast_node_size(kind), MEMORY_TAG_AST);
     node->kind = kind;
     node->type = type;
     return node;
 }
 
+void ast_node_buffer_init(struct ast_node_buffer * buffer)
+{
+    assert(buffer != NULL);
+    buffer->nodes = buffer->inline_nodes;
+    buffer->count = 0;
+    buffer->capacity = AST_NODE_BUFFER_INLINE_SIZE;
+}
+
+void ast_node_buffer_push(struct memory_blob_pool * pool, struct ast_node_buffer * buffer, struct ast_node * node)
+{
+    assert(pool != NULL);
+    assert(buffer != NULL);
+
+    if (buffer->count == buffer->capacity) {
+        unsigned int capacity = buffer->capacity * 2;
+        struct ast_node ** nodes = memory_blob_pool_alloc_tagged(pool, sizeof(struct ast_node *) * capacity, MEMORY_TAG_AST);
+        memcpy(nodes, buffer->nodes, sizeof(struct ast_node *) * buffer->count);
+        buffer->nodes = nodes;
+        buffer->capacity = capacity;
+    }
+
+    buffer->nodes[buffer->count++] = node;
+}
+
+struct ast_node ** ast_node_buffer_finish(struct memory_blob_pool * pool, const struct ast_node_buffer * buffer)
+{
+    assert(pool != NULL);
+    assert(buffer != NULL);
+
+    if (buffer->count == 0) {
+        return NULL;
+    }
+
+    struct ast_node ** nodes = memory_blob_pool_alloc_tagged(pool, sizeof(struct ast_node *) * buffer->count, MEMORY_TAG_AST);
+    memcpy(nodes, buffer->nodes, sizeof(struct ast_node *) * buffer->count);
+    return nodes;
+}
+
 bool ast_statement_always_returns(const struct ast_node * node)
 {
     if (node == NULL) {
@@ -75,7 +75,14 @@ struct type * cast_binary_operands(struct parser_context * ctx, enum warning_cod
         return target_type;
     }
 
-    return type_resolve(lhs_type, rhs_type);
+    struct type * type = type_resolve(lhs_type, rhs_type);
+
+    if (type == NULL) {
+        parser_report_error(ctx, op_token, "type mismatch between '%s' and '%s'", type_stringify(lhs_type), type_stringify(rhs_type));
+        return lhs_type;
+    }
+
+    return type;
 }
 
 static const struct op_entry * match_operator(const struct token * token, const struct binary_op_rule * rule)
@@ -106,14 +113,14 @@ struct ast_node * parse_binary_expression(struct parser_context * ctx, const str
     const struct op_entry * entry;
 
     while ((entry = match_operator(parser_peek_token(ctx), rule)) != NULL) {
-        struct token * current_token = parser_get_token(ctx);
+        struct token op_token = *parser_get_token(ctx);
         struct ast_node * rhs = rule->operand_parser(ctx);
 
         if (rhs == NULL) {
             return NULL;
         }
 
-        struct ast_node * binary_expression = ast_create_node(ctx->pool, rule->node_kind, cast_binary_operands(ctx, rule->sign_warning, current_token, &lhs, &rhs));
+        struct ast_node * binary_expression = ast_create_node(ctx->pool, rule->node_kind, cast_binary_operands(ctx, rule->sign_warning, &op_token, &lhs, &rhs));
         binary_expression->content.binary_expression.operation = entry->operation;
         binary_expression->content.binary_expression.lhs = lhs;
         binary_expression->content.binary_expression.rhs = rhs;
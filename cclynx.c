@@ -3,6 +3,8 @@
 
 #include "cclynx.h"
 #include "allocator.h"
+#include "hashmap.h"
+#include "identifier.h"
 
 
 void cclynx_init(struct cclynx_context * ctx)
@@ -10,10 +12,26 @@ void cclynx_init(struct cclynx_context * ctx)
     assert(ctx != NULL);
     memset(ctx, 0, sizeof(struct cclynx_context));
     memory_blob_pool_init(&ctx->pool, DEFAULT_MEMORY_BLOB_SIZE, DEFAULT_MEMORY_BLOB_ALIGNMENT);
+    memory_blob_pool_init(&ctx->scratch, DEFAULT_MEMORY_BLOB_SIZE, DEFAULT_MEMORY_BLOB_ALIGNMENT);
+}
+
+/*
+ * Prepares the context for the next translation unit: everything allocated
+ * for the previous unit is released (the arena keeps its blobs) and the
+ * identifier table starts over empty.
+ */
+void cclynx_reset(struct cclynx_context * ctx)
+{
+    assert(ctx != NULL);
+    memory_blob_pool_reset(&ctx->pool);
+    memory_blob_pool_reset(&ctx->scratch);
+    identifier_table_init(&ctx->identifier_table, &ctx->pool);
+    memset(&ctx->global_scope, 0, sizeof(struct scope));
 }
 
 void cclynx_free(struct cclynx_context * ctx)
 {
     assert(ctx != NULL);
     memory_blob_pool_free(&ctx->pool, false);
+    memory_blob_pool_free(&ctx->scratch, false);
 }
@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -38,11 +40,11 @@ void error_list_add(struct error_list * list, const char * fmt, ...)
     int len = vsnprintf(NULL, 0, fmt, args_copy);
     va_end(args_copy);
 
-    char * message = memory_blob_pool_alloc(list->pool, len + 1);
+    char * message = memory_blob_pool_alloc_tagged(list->pool, len + 1, MEMORY_TAG_ERRORS);
     vsnprintf(message, len + 1, fmt, args);
     va_end(args);
 
-    struct error_item * entry = memory_blob_pool_alloc(list->pool, sizeof(struct error_item));
+    struct error_item * entry = memory_blob_pool_alloc_tagged(list->pool, sizeof(struct error_item), MEMORY_TAG_ERRORS);
     entry->message = message;
     entry->next = NULL;
 
@@ -54,6 +56,8 @@ void error_list_print(const struct error_list * list)
 {
     assert(list != NULL);
 
+    flockfile(stderr);
+
     const struct error_item * entry = list->head;
     while (entry != NULL) {
         fprintf(stderr, "%s", entry->message);
@@ -65,6 +69,7 @@ void error_list_print(const struct error_list * list)
     }
 
     fflush(stderr);
+    funlockfile(stderr);
 }
 
 _Noreturn void cclynx_fatal_error(const char * fmt, ...)
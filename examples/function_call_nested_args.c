@@ -0,0 +1,10 @@
+// expected return: 54
+int twice(int x) {
+    return x + x;
+}
+int mix(int a, int b, int c, int d, int e, int f, int g, int h, int i) {
+    return a - b + c * d - e + f - g + h * i;
+}
+int main() {
+    return mix(twice(5), 3, twice(2), 4, 1, twice(twice(1)), 2, twice(3), 5);
+}
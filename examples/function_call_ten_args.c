@@ -0,0 +1,7 @@
+// expected return: 100
+int sum(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j) {
+    return a + b + c + d + e + f + g + h + i * j;
+}
+int main() {
+    return sum(1, 2, 3, 4, 5, 6, 7, 8, 9, 6) + sum(2, 1, 1, 1, 1, 1, 1, 1, 1, 1);
+}
@@ -4,50 +4,226 @@
 #include "hashmap.h"
 #include "allocator.h"
 
+#define HASHMAP_MIN_CAPACITY (8)
 
+#define HASHMAP_HASH_SEED       (0x243f6a8885a308d3ull)
+#define HASHMAP_HASH_MULTIPLIER (0x9e3779b97f4a7c15ull)
+#define HASHMAP_HASH_FINALIZER  (0xd6e8feb86659fd93ull)
+
+#define hashmap_is_overloaded(count, capacity) ((count) * 4 >= (capacity) * 3)
+
+static void hashmap_grow(struct hashmap * map);
+static void hashmap_place(struct hashmap_entry * entries, size_t capacity, size_t index, size_t distance, struct hashmap_entry entry);
+
+
+static uint64_t hashmap_load64(const char * p)
+{
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+static uint64_t hashmap_load32(const char * p)
+{
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+/* the last 1..8 bytes of the key, read with overlapping loads so nothing past the key is touched */
+static uint64_t hashmap_load_tail(const char * p, size_t len)
+{
+    if (len >= 4) {
+        return (hashmap_load32(p) << 32) | hashmap_load32(p + len - 4);
+    }
+    if (len > 0) {
+        const unsigned char * bytes = (const unsigned char *)p;
+        return ((uint64_t)bytes[0] << 16) | ((uint64_t)bytes[len / 2] << 8) | bytes[len - 1];
+    }
+    return 0;
+}
+
+/*
+ * Multiply-xorshift over 8-byte words: one multiply per word instead of one
+ * per byte, and the final mix spreads every input bit over the low bits the
+ * slot mask keeps.
+ */
 unsigned int hashmap_hash(const char * key, size_t len)
 {
     assert(key != NULL);
-    unsigned int hash = 0;
-    for (size_t i = 0; i < len; ++i) {
-        hash = hash * 31 + (unsigned int) key[i];
+
+    uint64_t hash = HASHMAP_HASH_SEED ^ ((uint64_t)len * HASHMAP_HASH_MULTIPLIER);
+    size_t remaining = len;
+
+    while (remaining > 8) {
+        hash = (hash ^ hashmap_load64(key)) * HASHMAP_HASH_MULTIPLIER;
+        hash ^= hash >> 29;
+        key += 8;
+        remaining -= 8;
     }
-    return hash;
+
+    hash = (hash ^ hashmap_load_tail(key, remaining)) * HASHMAP_HASH_MULTIPLIER;
+    hash ^= hash >> 32;
+    hash *= HASHMAP_HASH_FINALIZER;
+    hash ^= hash >> 29;
+
+    return (unsigned int)hash;
+}
+
+static struct hashmap_entry * hashmap_alloc_entries(struct memory_blob_pool * pool, size_t capacity)
+{
+    struct hashmap_entry * entries = memory_blob_pool_alloc_tagged(pool, sizeof(struct hashmap_entry) * capacity, MEMORY_TAG_HASHMAP);
+    memset(entries, 0, sizeof(struct hashmap_entry) * capacity);
+    return entries;
 }
 
 void hashmap_init(struct hashmap * map, size_t capacity, struct memory_blob_pool * pool)
 {
     assert(map != NULL);
     assert(pool != NULL);
-    map->capacity = capacity;
+
+    size_t slots = HASHMAP_MIN_CAPACITY;
+    while (slots < capacity) {
+        slots *= 2;
+    }
+
+    map->capacity = slots;
+    map->count = 0;
     map->pool = pool;
-    map->buckets = memory_blob_pool_alloc(pool, sizeof(struct hashmap_entry *) * capacity);
+    map->entries = hashmap_alloc_entries(pool, slots);
+}
+
+/*
+ * Stops at the key's slot, or at the slot a new entry for it would take:
+ * an empty one or one whose entry is closer to home than the probe is.
+ */
+static bool hashmap_probe(const struct hashmap * map, const char * key, size_t len, uint32_t hash, size_t * index_out, size_t * distance_out)
+{
+    size_t mask = map->capacity - 1;
+    size_t index = hash & mask;
+    size_t distance = 0;
+    bool found = false;
+
+    for (;; ++distance, index = (index + 1) & mask) {
+        const struct hashmap_entry * entry = &map->entries[index];
+
+        if (entry->key == NULL || ((index - entry->hash) & mask) < distance) {
+            break;
+        }
+
+        if (entry->hash == hash && entry->len == len && memcmp(entry->key, key, len) == 0) {
+            found = true;
+            break;
+        }
+    }
+
+    *index_out = index;
+    *distance_out = distance;
+    return found;
 }
 
 void * hashmap_find(struct hashmap * map, const char * key, size_t len)
 {
     assert(map != NULL);
     assert(key != NULL);
-    unsigned int index = hashmap_hash(key, len) % map->capacity;
 
-    for (struct hashmap_entry * it = map->buckets[index]; it != NULL; it = it->next) {
-        if (strncmp(key, it->key, len) == 0 && it->key[len] == '\0') {
-            return it->value;
-        }
+    size_t index, distance;
+
+    if (hashmap_probe(map, key, len, hashmap_hash(key, len), &index, &distance)) {
+        return map->entries[index].value;
     }
 
     return NULL;
 }
 
+/*
+ * Finds the entry for the key or adds one with a NULL value, in a single
+ * probe. A new entry keeps the given key pointer; the caller may point it
+ * at a longer-lived copy with the same bytes. The returned entry is only
+ * valid until the next insertion.
+ */
+struct hashmap_entry * hashmap_intern(struct hashmap * map, const char * key, size_t len, uint32_t hash, bool * inserted)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+    assert(inserted != NULL);
+
+    size_t index, distance;
+
+    if (hashmap_probe(map, key, len, hash, &index, &distance)) {
+        *inserted = false;
+        return &map->entries[index];
+    }
+
+    if (hashmap_is_overloaded(map->count + 1, map->capacity)) {
+        hashmap_grow(map);
+        hashmap_probe(map, key, len, hash, &index, &distance);
+    }
+
+    struct hashmap_entry * slot = &map->entries[index];
+
+    if (slot->key != NULL) {
+        size_t mask = map->capacity - 1;
+        hashmap_place(map->entries, map->capacity, (index + 1) & mask, ((index - slot->hash) & mask) + 1, *slot);
+    }
+
+    slot->key = key;
+    slot->value = NULL;
+    slot->hash = hash;
+    slot->len = (uint32_t)len;
+    ++map->count;
+
+    *inserted = true;
+    return slot;
+}
+
 void hashmap_insert(struct hashmap * map, const char * key, void * value)
 {
     assert(map != NULL);
     assert(key != NULL);
-    unsigned int index = hashmap_hash(key, strlen(key)) % map->capacity;
 
-    struct hashmap_entry * entry = memory_blob_pool_alloc(map->pool, sizeof(struct hashmap_entry));
-    entry->key = key;
-    entry->value = value;
-    entry->next = map->buckets[index];
-    map->buckets[index] = entry;
+    size_t len = strlen(key);
+    bool inserted;
+
+    hashmap_intern(map, key, len, hashmap_hash(key, len), &inserted)->value = value;
+}
+
+/* the key is known to be absent, the probe resumes at index having already walked distance slots */
+void hashmap_place(struct hashmap_entry * entries, size_t capacity, size_t index, size_t distance, struct hashmap_entry entry)
+{
+    size_t mask = capacity - 1;
+
+    for (;; ++distance, index = (index + 1) & mask) {
+        struct hashmap_entry * slot = &entries[index];
+
+        if (slot->key == NULL) {
+            *slot = entry;
+            return;
+        }
+
+        size_t slot_distance = (index - slot->hash) & mask;
+
+        if (slot_distance < distance) {
+            struct hashmap_entry displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+            distance = slot_distance;
+        }
+    }
+}
+
+/* the old slot array stays in the pool until it is reset */
+void hashmap_grow(struct hashmap * map)
+{
+    size_t capacity = map->capacity * 2;
+    struct hashmap_entry * entries = hashmap_alloc_entries(map->pool, capacity);
+
+    for (size_t i = 0; i < map->capacity; ++i) {
+        if (map->entries[i].key != NULL) {
+            hashmap_place(entries, capacity, map->entries[i].hash & (capacity - 1), 0, map->entries[i]);
+        }
+    }
+
+    map->entries = entries;
+    map->capacity = capacity;
 }
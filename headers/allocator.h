@@ -4,14 +4,45 @@
 #include <stdbool.h>
 #include <memory.h>
 
-#define DEFAULT_MEMORY_BLOB_SIZE (1024 * 1024)
-#define DEFAULT_MEMORY_BLOB_ALIGNMENT (16)
+#define DEFAULT_MEMORY_BLOB_SIZE (64 * 1024)
+#define MAX_MEMORY_BLOB_SIZE (16 * 1024 * 1024)
+#define DEFAULT_MEMORY_BLOB_ALIGNMENT (8)
 #define DEFAULT_MEMORY_BLOB_CAPACITY (8)
 
+/* requests above this fraction of the next blob get a blob of their own */
+#define LARGE_ALLOCATION_DIVISOR (4)
+
+enum memory_tag
+{
+    MEMORY_TAG_OTHER,
+    MEMORY_TAG_TOKENS,
+    MEMORY_TAG_IDENTIFIERS,
+    MEMORY_TAG_HASHMAP,
+    MEMORY_TAG_AST,
+    MEMORY_TAG_SYMBOLS,
+    MEMORY_TAG_IR_INSTRUCTIONS,
+    MEMORY_TAG_IR_OPERANDS,
+    MEMORY_TAG_CFG,
+    MEMORY_TAG_ERRORS,
+    MEMORY_TAG_COUNT,
+};
+
+struct memory_blob_pool_stats {
+    size_t requested[MEMORY_TAG_COUNT];
+    size_t padding[MEMORY_TAG_COUNT];
+    size_t allocations[MEMORY_TAG_COUNT];
+    size_t blob_count; /* every blob ever opened, large ones included */
+    size_t used;
+    size_t peak_used;
+    size_t reserved;
+    size_t peak_reserved;
+};
+
 struct memory_blob {
     void * memory;
     size_t used;
     size_t capacity;
+    size_t dirty; /* bytes past this offset have never been handed out and are still zero */
 };
 
 struct memory_blob_pool {
@@ -19,13 +50,34 @@ struct memory_blob_pool {
     size_t blob_count;
     size_t blob_capacity;
     size_t blob_size;
+    size_t next_blob_size;
     size_t alignment;
+    size_t current_blob; /* blobs after this one are kept for reuse and hold nothing live */
+    struct memory_blob ** large_blobs;
+    size_t large_blob_count;
+    size_t large_blob_capacity;
+    struct memory_blob_pool_stats stats;
+};
+
+struct memory_blob_pool_mark {
+    size_t blob_index;
+    size_t used;
+    size_t large_blob_count;
+    size_t pool_used;
 };
 
 struct memory_blob_pool * memory_blob_pool_create(size_t blob_size, size_t alignment);
 
 void memory_blob_pool_init(struct memory_blob_pool * pool, size_t blob_size, size_t alignment);
 void * memory_blob_pool_alloc(struct memory_blob_pool * pool, size_t size);
+void * memory_blob_pool_alloc_tagged(struct memory_blob_pool * pool, size_t size, enum memory_tag tag);
 void memory_blob_pool_free(struct memory_blob_pool * pool, bool free_pool);
 
+void memory_blob_pool_reset(struct memory_blob_pool * pool);
+struct memory_blob_pool_mark memory_blob_pool_mark(const struct memory_blob_pool * pool);
+void memory_blob_pool_rewind(struct memory_blob_pool * pool, struct memory_blob_pool_mark mark);
+
+const char * memory_tag_name(enum memory_tag tag);
+void memory_blob_pool_stats_merge(struct memory_blob_pool_stats * target, const struct memory_blob_pool_stats * source);
+
 #endif /* CCLYNX_ALLOCATOR_H */
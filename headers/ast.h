@@ -2,9 +2,9 @@
 #define CCLYNX_AST_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
 
-#define MAX_AST_FUNCTION_PARAMETER_COUNT (3)
-#define MAX_AST_FUNCTION_ARGUMENT_COUNT (3)
+#define AST_NODE_BUFFER_INLINE_SIZE (8)
 
 struct symbol;
 struct identifier;
@@ -55,8 +55,15 @@ enum assignment_type {
     ASSIGNMENT_REGULAR = 1,
 };
 
+/*
+ * Nodes are allocated only as large as the content member their kind uses,
+ * so content must only be accessed through that member and nodes must
+ * never be copied by value.
+ */
 struct ast_node
 {
+    struct type * type;
+    enum ast_node_kind kind;
     union
     {
         struct symbol * symbol;
@@ -85,13 +92,13 @@ struct ast_node
                 PARAMETER_PRESENCE_VOID,
                 PARAMETER_PRESENCE_SPECIFIED,
             } parameter_presence;
-            struct ast_node * parameters[MAX_AST_FUNCTION_PARAMETER_COUNT];
+            struct ast_node ** parameters;
             unsigned int parameter_count;
         } function_definition;
         struct function_call
         {
-        struct symbol * function;
-            struct ast_node * arguments[MAX_AST_FUNCTION_ARGUMENT_COUNT];
+            struct symbol * function;
+            struct ast_node ** arguments;
             unsigned int argument_count;
         } function_call;
         struct assignment {
@@ -109,13 +116,24 @@ struct ast_node
             struct ast_node * false_branch;
         } if_statement;
     } content;
-    struct type * type;
-    enum ast_node_kind kind;
 };
 
 struct memory_blob_pool;
 
+/* collects a list of unknown length before it is copied out at its exact size */
+struct ast_node_buffer
+{
+    struct ast_node * inline_nodes[AST_NODE_BUFFER_INLINE_SIZE];
+    struct ast_node ** nodes;
+    unsigned int count;
+    unsigned int capacity;
+};
+
 struct ast_node * ast_create_node(struct memory_blob_pool * pool, enum ast_node_kind kind, struct type * type);
+size_t ast_node_size(enum ast_node_kind kind);
+void ast_node_buffer_init(struct ast_node_buffer * buffer);
+void ast_node_buffer_push(struct memory_blob_pool * pool, struct ast_node_buffer * buffer, struct ast_node * node);
+struct ast_node ** ast_node_buffer_finish(struct memory_blob_pool * pool, const struct ast_node_buffer * buffer);
 bool ast_statement_always_returns(const struct ast_node * node);
 
 static inline bool ast_is_empty_compound_statement(const struct ast_node * node)
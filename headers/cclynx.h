@@ -4,14 +4,18 @@
 #include "allocator.h"
 #include "hashmap.h"
 #include "scope.h"
+#include "optimizer.h"
 
 struct cclynx_context {
     struct memory_blob_pool pool;
+    struct memory_blob_pool scratch; /* optimizer tables that live for one pass over one function */
     struct hashmap identifier_table;
     struct scope global_scope;
+    struct optimizer_stats optimizer_stats; /* summed over every unit compiled with the context */
 };
 
 void cclynx_init(struct cclynx_context * ctx);
+void cclynx_reset(struct cclynx_context * ctx);
 void cclynx_free(struct cclynx_context * ctx);
 
 #endif /* CCLYNX_H */
@@ -1,21 +1,31 @@
 #ifndef CCLYNX_HASHMAP_H
 #define CCLYNX_HASHMAP_H 1
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 struct memory_blob_pool;
 
+/* an empty slot has a NULL key */
 struct hashmap_entry
 {
     const char * key;
     void * value;
-    struct hashmap_entry * next;
+    uint32_t hash;
+    uint32_t len;
 };
 
+/*
+ * Open addressing with Robin Hood probing over a power-of-two slot array.
+ * The slot array lives in the pool and is replaced by a twice larger one
+ * once the map gets three quarters full.
+ */
 struct hashmap
 {
-    struct hashmap_entry ** buckets;
+    struct hashmap_entry * entries;
     size_t capacity;
+    size_t count;
     struct memory_blob_pool * pool;
 };
 
@@ -24,5 +34,6 @@ unsigned int hashmap_hash(const char * key, size_t len);
 void hashmap_init(struct hashmap * map, size_t capacity, struct memory_blob_pool * pool);
 void * hashmap_find(struct hashmap * map, const char * key, size_t len);
 void hashmap_insert(struct hashmap * map, const char * key, void * value);
+struct hashmap_entry * hashmap_intern(struct hashmap * map, const char * key, size_t len, uint32_t hash, bool * inserted);
 
 #endif /* CCLYNX_HASHMAP_H */
@@ -8,9 +8,10 @@ struct symbol;
 
 #define identifier_attach_symbol(pool, identifier, symbol_name)             \
     {                                                                       \
-        struct symbol_list * element = (struct symbol_list *)                \
-            memory_blob_pool_alloc((pool), sizeof(struct symbol_list));      \
-        memset(element, 0, sizeof(struct symbol_list));                      \
+        struct symbol_list * element = (struct symbol_list *)               \
+            memory_blob_pool_alloc_tagged(                                  \
+                (pool), sizeof(struct symbol_list), MEMORY_TAG_SYMBOLS);    \
+        memset(element, 0, sizeof(struct symbol_list));                     \
         element->symbol = (symbol_name);                                    \
         element->next = (identifier)->symbols;                              \
         (identifier)->symbols = element;                                    \
@@ -35,11 +36,10 @@ struct identifier
     enum keyword_code keyword_code;
 };
 
-void init_keywords(struct hashmap * identifier_table, struct memory_blob_pool * pool);
+void identifier_table_init(struct hashmap * identifier_table, struct memory_blob_pool * pool);
 
-struct identifier * identifier_create(struct hashmap * identifier_table, struct memory_blob_pool * pool, const char * name);
-struct identifier * identifier_lookup(struct hashmap * identifier_table, const char * name, unsigned int len);
-struct identifier * identifier_insert(struct hashmap * identifier_table, struct memory_blob_pool * pool, const char * name, unsigned int len);
+const struct identifier * keyword_lookup(const char * name, unsigned int len);
+struct identifier * identifier_intern(struct hashmap * identifier_table, struct memory_blob_pool * pool, const char * name, unsigned int len);
 void identifier_detach_symbol(struct identifier * identifier, const struct symbol * symbol);
 
 #endif /* CCLYNX_IDENTIFIER_H */
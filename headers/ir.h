@@ -1,9 +1,18 @@
 #ifndef CCLYNX_IR_H
 #define CCLYNX_IR_H 1
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
-#define INITIAL_INSTRUCTION_COUNT (100000)
+#define IR_INSTRUCTION_CHUNK_SHIFT (8)
+#define IR_INSTRUCTION_CHUNK_SIZE (1 << IR_INSTRUCTION_CHUNK_SHIFT)
+#define IR_INITIAL_CHUNK_CAPACITY (8)
+#define IR_REGISTER_ARGUMENT_COUNT (8)
+#define IR_OPERAND_FIRST_CHUNK_SHIFT (4)
+#define IR_OPERAND_CHUNK_COUNT (28)
+#define IR_CONSTANT_TABLE_INITIAL_CAPACITY (16)
 
 struct type;
 struct ast_node;
@@ -16,20 +25,30 @@ enum operand_kind
     OPERAND_KIND_FUNCTION_NAME,
     OPERAND_KIND_VARIABLE,
     OPERAND_KIND_LABEL,
+    OPERAND_KIND_PHI,
 };
 
+typedef uint32_t ir_operand_id;
+
+#define IR_OPERAND_NONE ((ir_operand_id) 0)
+
 struct ir_operand
 {
     union
     {
         struct variable {
-            struct symbol * symbol;
+            struct symbol * symbol; /* NULL for argument staging slots */
             size_t offset;
         } variable;
         struct function {
             struct identifier * identifier;
-            size_t local_vars_size;
+            ir_operand_id * staged_arguments; /* call sites only, IR_OPERAND_NONE entries are passed directly */
         } function;
+        struct phi {
+            ir_operand_id * values;
+            ir_operand_id * predecessors; /* label starting the predecessor block, the OP_FUNC operand for the entry block */
+            uint32_t count;
+        } phi;
         unsigned long long int temp_id;
         unsigned long long int label_id;
         long long int int_value;
@@ -70,41 +89,100 @@ enum opcode
     OP_CALL,
     OP_ARG,
     OP_STORE_PARAM,
+    OP_PHI,
+    OP_COPY,
+    OP_PARAM,
 };
 
 struct ir_instruction
 {
-    struct ir_operand * op1;
-    struct ir_operand * op2;
-    struct ir_operand * result;
+    ir_operand_id op1;
+    ir_operand_id op2;
+    ir_operand_id result;
     enum opcode code;
 };
 
-struct ir_program
+/*
+ * Chunk k holds 16 << k operands, so the table grows
+ * without moving operands and the chunk list never has to be reallocated.
+ * ID 0 is IR_OPERAND_NONE and is never handed out.
+ */
+struct ir_operand_table
 {
-    struct ir_instruction ** instructions;
-    size_t position;
-    size_t capacity;
+    struct ir_operand * chunks[IR_OPERAND_CHUNK_COUNT];
+    uint32_t count;
+    ir_operand_id * constants; /* open addressing, interns constants by value and type */
+    uint32_t constant_capacity;
+    uint32_t constant_count;
+    bool exhausted; /* the ID space ran out, the function must not be compiled */
 };
 
-#define IR_MAX_OPERAND_COUNT (1024)
+struct ir_function
+{
+    struct identifier * name;
+    size_t local_vars_size;
+    size_t begin; /* instruction range from OP_FUNC up to and including OP_FUNC_END */
+    size_t end;
+    struct ir_operand_table operands;
+};
 
 struct memory_blob_pool;
 
+/* instructions live in fixed-size chunks, so growing never moves them */
+struct ir_program
+{
+    struct ir_instruction ** chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t position; /* number of instructions */
+    struct ir_function ** functions;
+    size_t function_count;
+    size_t function_capacity;
+    unsigned long long int temp_count; /* temporaries and labels are numbered across the program */
+    unsigned long long int label_count;
+    struct memory_blob_pool * pool;
+};
+
+static inline struct ir_instruction * ir_program_at(const struct ir_program * program, size_t index)
+{
+    return &program->chunks[index >> IR_INSTRUCTION_CHUNK_SHIFT][index & (IR_INSTRUCTION_CHUNK_SIZE - 1)];
+}
+
+static inline struct ir_instruction * ir_program_last(const struct ir_program * program)
+{
+    return ir_program_at(program, program->position - 1);
+}
+
+static inline struct ir_operand * ir_function_operand(const struct ir_function * function, ir_operand_id id)
+{
+    if (id == IR_OPERAND_NONE) {
+        return NULL;
+    }
+    uint32_t chunk = 31 - __builtin_clz((id >> IR_OPERAND_FIRST_CHUNK_SHIFT) + 1);
+    uint32_t first = ((1u << chunk) - 1) << IR_OPERAND_FIRST_CHUNK_SHIFT;
+    return &function->operands.chunks[chunk][id - first];
+}
+
 struct ir_context
 {
     struct memory_blob_pool * pool;
     unsigned long long int temp_id;
     unsigned long long int label_id;
-    struct ir_operand * last_variable;
+    ir_operand_id last_variable;
     unsigned int is_assign;
-    struct ir_instruction * current_func;
-    struct ir_operand operands[IR_MAX_OPERAND_COUNT];
-    size_t operand_pos;
+    struct ir_function * function;
+    const char * error; /* the first error, the program is unusable once it is set */
+    bool skip_unreachable; /* leave out what follows a statement that always returns */
 };
 
 void ir_context_init(struct ir_context * ctx, struct memory_blob_pool * pool);
 void ir_program_init(struct ir_program * program, struct memory_blob_pool * pool);
 void ir_program_generate(struct ir_context * ctx, struct ir_program * program, const struct ast_node * ast);
+struct ir_instruction * ir_emit(struct ir_program * program, const struct ir_instruction * instruction);
+ir_operand_id ir_function_add_operand(struct ir_function * function, struct memory_blob_pool * pool, enum operand_kind kind);
+ir_operand_id ir_function_constant(struct ir_function * function, struct memory_blob_pool * pool, long long int value, struct type * type);
+const struct ir_function * ir_program_exhausted_function(const struct ir_program * program);
+ir_operand_id ir_function_new_temporary(struct ir_program * program, struct ir_function * function, struct type * type);
+ir_operand_id ir_function_new_label(struct ir_program * program, struct ir_function * function);
 
 #endif /* CCLYNX_IR_H */
@@ -0,0 +1,51 @@
+#ifndef CCLYNX_IR_CFG_H
+#define CCLYNX_IR_CFG_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define IR_CFG_NO_BLOCK (UINT32_MAX)
+#define IR_CFG_MAX_SUCCESSORS (2)
+
+struct ir_program;
+struct ir_function;
+struct memory_blob_pool;
+
+struct ir_basic_block
+{
+    size_t begin; /* instruction range, a label can only start a block and a jump or return can only end one */
+    size_t end;
+    uint32_t * predecessors;
+    uint32_t predecessor_count;
+    uint32_t successors[IR_CFG_MAX_SUCCESSORS]; /* fall-through first */
+    uint32_t successor_count;
+    uint32_t immediate_dominator; /* IR_CFG_NO_BLOCK for the entry block and unreachable blocks */
+    uint32_t loop_header; /* header of the innermost natural loop containing the block, IR_CFG_NO_BLOCK outside loops */
+    uint32_t loop_depth;
+    uint32_t rpo_index; /* IR_CFG_NO_BLOCK for unreachable blocks */
+};
+
+struct ir_cfg
+{
+    const struct ir_function * function;
+    struct ir_basic_block * blocks; /* in instruction order, block 0 is the entry */
+    uint32_t block_count;
+    uint32_t * reverse_postorder; /* reachable blocks only */
+    uint32_t reachable_count;
+};
+
+void ir_cfg_build(struct ir_cfg * cfg, const struct ir_program * program, const struct ir_function * function, struct memory_blob_pool * pool);
+bool ir_cfg_dominates(const struct ir_cfg * cfg, uint32_t dominator, uint32_t block);
+
+static inline bool ir_cfg_is_reachable(const struct ir_cfg * cfg, uint32_t block)
+{
+    return cfg->blocks[block].rpo_index != IR_CFG_NO_BLOCK;
+}
+
+static inline bool ir_cfg_is_loop_header(const struct ir_cfg * cfg, uint32_t block)
+{
+    return cfg->blocks[block].loop_header == block;
+}
+
+#endif /* CCLYNX_IR_CFG_H */
@@ -0,0 +1,68 @@
+#ifndef CCLYNX_OPTIMIZER_H
+#define CCLYNX_OPTIMIZER_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ir.h"
+
+#define OPTIMIZATION_LEVEL_MAX (2)
+#define OPTIMIZER_INITIAL_OPERAND_CAPACITY (64)
+
+/* the passes a level runs, --passes picks them one by one to test them alone */
+#define OPTIMIZER_PASS_FOLD (1 << 0)
+#define OPTIMIZER_PASS_SSA (1 << 1)
+#define OPTIMIZER_PASS_OUT_OF_SSA (1 << 2) /* never part of a level, the code generator leaves SSA form anyway */
+#define OPTIMIZER_PASS_DCE (1 << 3)
+#define OPTIMIZER_PASS_GVN (1 << 4)
+
+struct memory_blob_pool;
+
+/* what value numbering and dead code elimination removed, summed over the functions */
+struct optimizer_stats
+{
+    size_t redundant_instructions;
+    size_t dead_instructions;
+    size_t unreachable_blocks;
+    size_t nops;
+    size_t branches; /* jumps to the next instruction and labels nothing refers to */
+};
+
+/* scratch tables indexed by operand ID, reused by every function that fits in them */
+struct optimizer_context
+{
+    struct memory_blob_pool * pool;
+    struct memory_blob_pool * scratch; /* rewound after every pass over a function, never holds IR */
+    unsigned int level;
+    unsigned int passes; /* OPTIMIZER_PASS_* */
+    ir_operand_id * aliases; /* temporary to the temporary that replaced it */
+    ir_operand_id * constants; /* temporary to the constant it is known to hold */
+    uint32_t * use_counts;
+    uint32_t * definitions; /* temporary to the index of its defining instruction, from the function begin */
+    uint32_t operand_count; /* of the prepared function, operands added later have no entries */
+    uint32_t operand_capacity;
+    struct optimizer_stats stats;
+};
+
+void optimizer_init(struct optimizer_context * ctx, struct memory_blob_pool * pool, struct memory_blob_pool * scratch, unsigned int level);
+void optimizer_run(struct optimizer_context * ctx, struct ir_program * program);
+unsigned int optimizer_pass_by_name(const char * name, size_t len);
+void optimizer_leave_ssa(struct optimizer_context * ctx, struct ir_program * program);
+void optimizer_prepare_function(struct optimizer_context * ctx, const struct ir_function * function);
+void optimizer_stats_merge(struct optimizer_stats * target, const struct optimizer_stats * source);
+
+void ir_fold_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+void ir_gvn_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+void ir_dce_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+void ir_ssa_construct_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+void ir_ssa_destruct_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+
+static inline ir_operand_id optimizer_resolve_alias(const struct optimizer_context * ctx, ir_operand_id id)
+{
+    while (id != IR_OPERAND_NONE && id < ctx->operand_count && ctx->aliases[id] != IR_OPERAND_NONE) {
+        id = ctx->aliases[id];
+    }
+    return id;
+}
+
+#endif /* CCLYNX_OPTIMIZER_H */
@@ -2,14 +2,23 @@
 #define CCLYNX_PRINT_H 1
 
 #include <stdio.h>
+#include <stddef.h>
 
 struct token;
+struct source;
 struct ast_node;
 struct ir_program;
+struct ir_cfg;
+struct memory_blob_pool_stats;
+struct optimizer_stats;
 
-void print_token(const struct token * token, FILE * file);
+void print_token(const struct token * token, const struct source * source, FILE * file);
 void print_ast(const struct ast_node * ast, FILE * file);
 void print_ast_dot(const struct ast_node * ast, FILE * file);
 void print_ir_program(const struct ir_program * program, FILE * file);
+void print_ir_cfg(const struct ir_program * program, const struct ir_cfg * cfgs, size_t count, FILE * file);
+void print_ir_cfg_dot(const struct ir_program * program, const struct ir_cfg * cfgs, size_t count, FILE * file);
+void print_memory_stats(const struct memory_blob_pool_stats * stats, FILE * file);
+void print_optimizer_stats(const struct optimizer_stats * stats, FILE * file);
 
 #endif /* CCLYNX_PRINT_H */
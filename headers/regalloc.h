@@ -0,0 +1,51 @@
+#ifndef CCLYNX_REGALLOC_H
+#define CCLYNX_REGALLOC_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ir.h"
+
+#define REGALLOC_NO_INTERVAL (UINT32_MAX)
+#define REGALLOC_INITIAL_OPERAND_CAPACITY (64)
+
+struct memory_blob_pool;
+
+/* instruction indices of the program, from the first to the last one the temporary is live at */
+struct live_interval
+{
+    ir_operand_id operand;
+    size_t start;
+    size_t end;
+    uint32_t location; /* register number below the register count, spill slot number above it */
+    ir_operand_id hint; /* temporary copied into this one where it starts, sharing its register saves the move */
+};
+
+/* the tables are indexed by operand ID and reused by every function that fits in them */
+struct regalloc_context
+{
+    struct memory_blob_pool * pool;
+    uint32_t register_count;
+    struct live_interval * intervals; /* by start */
+    uint32_t interval_count;
+    uint32_t * operand_intervals; /* by operand ID, REGALLOC_NO_INTERVAL for operands that are not temporaries */
+    uint32_t * interval_blocks; /* scratch, block of the first occurrence */
+    uint32_t operand_capacity;
+    uint32_t spill_slot_count;
+};
+
+void regalloc_init(struct regalloc_context * ctx, struct memory_blob_pool * pool, uint32_t register_count);
+void regalloc_function(struct regalloc_context * ctx, const struct ir_program * program, const struct ir_function * function);
+
+static inline const struct live_interval * regalloc_interval(const struct regalloc_context * ctx, ir_operand_id id)
+{
+    return &ctx->intervals[ctx->operand_intervals[id]];
+}
+
+static inline bool regalloc_is_spilled(const struct regalloc_context * ctx, const struct live_interval * interval)
+{
+    return interval->location >= ctx->register_count;
+}
+
+#endif /* CCLYNX_REGALLOC_H */
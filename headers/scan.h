@@ -0,0 +1,24 @@
+#ifndef CCLYNX_SCAN_H
+#define CCLYNX_SCAN_H 1
+
+#include <stddef.h>
+
+/* returns the first byte in [p, end) that is not whitespace, or end */
+typedef const char * (*scan_whitespace_fn)(const char * p, const char * end);
+/* returns the '*' of the first "*" "/" pair in [p, end), or NULL */
+typedef const char * (*scan_comment_end_fn)(const char * p, const char * end);
+
+struct scan_implementation
+{
+    const char * name;
+    scan_whitespace_fn skip_whitespace;
+    scan_comment_end_fn find_comment_end;
+};
+
+void scan_init(void);
+const struct scan_implementation * scan_available_implementations(size_t * count);
+
+const char * scan_skip_whitespace(const char * p, const char * end);
+const char * scan_find_comment_end(const char * p, const char * end);
+
+#endif /* CCLYNX_SCAN_H */
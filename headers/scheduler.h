@@ -0,0 +1,11 @@
+#ifndef CCLYNX_SCHEDULER_H
+#define CCLYNX_SCHEDULER_H 1
+
+#include <stddef.h>
+
+typedef void (*scheduler_task_fn)(void * worker_data, size_t task);
+
+unsigned int scheduler_default_worker_count(void);
+void scheduler_run(unsigned int worker_count, size_t task_count, scheduler_task_fn run_task, void ** worker_data);
+
+#endif /* CCLYNX_SCHEDULER_H */
@@ -9,10 +9,12 @@ struct scope
 {
     struct scope * enclosing;
     struct symbol_list * symbols;
+    unsigned int depth;
 };
 
 struct scope * scope_push(struct scope * scope, struct memory_blob_pool * pool);
 struct scope * scope_pop(const struct scope * scope);
+/* binds the symbol to its identifier as well, shadowing any outer binding */
 void scope_add_symbol(struct scope * scope, struct symbol * symbol, struct memory_blob_pool * pool);
 struct symbol * scope_find_symbol(const struct scope * scope, const struct identifier * identifier, enum symbol_kind symbol_kind);
 
@@ -14,7 +14,6 @@ struct source_span
 {
     uint32_t offset;
     uint32_t length;
-    struct source_position position;
 };
 
 struct source
@@ -23,14 +22,13 @@ struct source
     char * path;
     size_t cursor;
     size_t size;
-    uint32_t line;
-    uint32_t column;
-    uint32_t previous_column;
+    size_t mapped_size; /* non-zero when content is a file mapping rather than a heap buffer */
+    uint32_t * line_offsets; /* offset of the first byte of every line, built on the first position lookup */
+    uint32_t line_count;
 };
 
-void source_load(struct source * source, const char * path);
-int source_get_char(struct source * source);
-void source_unget_char(struct source * source, int ch);
+const char * source_load(struct source * source, const char * path);
+struct source_position source_resolve_position(struct source * source, uint32_t offset);
 void source_free(struct source * source);
 
 #endif /* CCLYNX_SOURCE_H */
\ No newline at end of file
@@ -2,14 +2,10 @@
 #define CCLYNX_SYMBOL_H 1
 
 #include <stdint.h>
-#include "source.h"
-
-#define MAX_SYMBOL_FUNCTION_PARAMETER_COUNT (3)
 
 struct hashmap;
 struct memory_blob_pool;
 struct type;
-struct ir_operand;
 
 enum symbol_kind
 {
@@ -27,12 +23,13 @@ struct symbol
     struct type * type;
     enum symbol_kind kind;
     unsigned int flags;
-    struct source_position declaration_position;
+    uint32_t declaration_offset;
+    unsigned int scope_depth;
     unsigned int parameter_count; /* SYMBOL_KIND_FUNCTION only */
     unsigned int parameter_index; /* SYMBOL_FLAG_FUNCTION_PARAMETER only */
     int parameter_presence; /* SYMBOL_KIND_FUNCTION only */
-    struct symbol * parameters[MAX_SYMBOL_FUNCTION_PARAMETER_COUNT]; /* SYMBOL_KIND_FUNCTION only */
-    struct ir_operand * ir_operand; /* set during IR generation */
+    struct symbol ** parameters; /* SYMBOL_KIND_FUNCTION only */
+    uint32_t ir_operand; /* set during IR generation, IR_OPERAND_NONE until then */
 };
 
 struct symbol_list
@@ -2,11 +2,17 @@
 #define CCLYNX_TARGET_ARM64_H 1
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#define CODEGEN_REG_COUNT (15)
-#define CODEGEN_REG_STACK_SIZE (16)
+#include "regalloc.h"
+
+#define CODEGEN_REG_COUNT (7)
 #define CODEGEN_BUF_SIZE (1024)
+
 struct ir_program;
+struct ir_function;
+struct memory_blob_pool;
 
 enum codegen_reg_kind
 {
@@ -17,18 +23,21 @@ struct codegen_reg
 {
     const char * name;
     enum codegen_reg_kind kind;
-    unsigned int busy;
 };
 
 struct codegen_context
 {
     struct codegen_reg regs[CODEGEN_REG_COUNT];
-    struct codegen_reg * reg_stack[CODEGEN_REG_STACK_SIZE];
-    unsigned int reg_stack_pos;
+    const struct live_interval * live[CODEGEN_REG_COUNT]; /* in the order they start */
+    unsigned int live_count;
+    uint32_t next_interval;
+    struct regalloc_context regalloc;
+    const struct ir_function * function;
+    size_t frame_size; /* frame slots and spill slots */
     char buf[CODEGEN_BUF_SIZE];
 };
 
-void codegen_context_init(struct codegen_context * ctx);
+void codegen_context_init(struct codegen_context * ctx, struct memory_blob_pool * pool);
 void target_arm64_generate(struct codegen_context * ctx, struct ir_program * program, FILE * file);
 
 #endif /* CCLYNX_TARGET_ARM64_H */
@@ -1,19 +1,21 @@
 #ifndef CCLYNX_TOKENIZER_H
 #define CCLYNX_TOKENIZER_H 1
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "source.h"
 
 struct hashmap;
 
-#define is_upper_char(ch) ((ch) >= 'A' && (ch) <= 'Z')
-#define is_lower_char(ch) ((ch) >= 'a' && (ch) <= 'z')
-#define is_char(ch) (is_lower_char(ch) || is_upper_char(ch))
-#define is_start_identifier_char(ch) (is_char(ch))
-#define is_identifier_char(ch) (is_char(ch) || (ch) == '_')
-
 #define TOKEN_FLAG_IS_UNSIGNED (1 << 0)
 
-#define token_first_ch(token) ((token)->source->content[(token)->span.offset])
+/* parser lookahead plus the tokens it still holds on to, must be a power of two */
+#define TOKEN_STREAM_RING_SIZE (16)
+
+#define TOKEN_BLOCK_SIZE (256)
+
+#define token_first_ch(token) ((token)->first_ch)
 
 #define token_is_identifier(token) \
     ((token)->kind == TOKEN_KIND_IDENTIFIER && (token)->identifier->keyword_code == KEYWORD_NONE)
@@ -28,6 +30,7 @@ struct identifier;
 
 enum token_kind
 {
+    TOKEN_KIND_ERROR = -2,
     TOKEN_KIND_EOS = -1,
     TOKEN_KIND_UNKNOWN_CHARACTER = 0,
     TOKEN_KIND_IDENTIFIER,
@@ -41,12 +44,11 @@ enum token_kind
 
 struct token
 {
-    struct source * source;
     struct identifier * identifier;
-    struct token * next;
     struct source_span span;
-    unsigned int flags;
     int kind;
+    uint8_t flags;
+    char first_ch;
 };
 
 extern struct token eos_token;
@@ -56,11 +58,43 @@ struct memory_blob_pool;
 struct tokenizer_context {
     struct memory_blob_pool * pool;
     struct hashmap * identifier_table;
+    const char * error; /* message of the last TOKEN_KIND_ERROR token */
 };
 
 void tokenizer_init(struct tokenizer_context * ctx, struct hashmap * identifier_table, struct memory_blob_pool * pool);
+/*
+ * The lexer runs a block of tokens at a time into parallel arrays, which
+ * end early at the end of the source or at a lexer error.
+ */
+struct token_block {
+    struct identifier * identifiers[TOKEN_BLOCK_SIZE];
+    uint32_t offsets[TOKEN_BLOCK_SIZE];
+    uint32_t lengths[TOKEN_BLOCK_SIZE];
+    int16_t kinds[TOKEN_BLOCK_SIZE];
+    uint8_t flags[TOKEN_BLOCK_SIZE];
+    unsigned int count;
+    unsigned int next;
+};
+
+/*
+ * Tokens are handed out on demand through a small ring, so memory does not
+ * grow with the file. A token stays valid until TOKEN_STREAM_RING_SIZE
+ * further tokens have been read; anything kept longer must be copied.
+ */
+struct token_stream {
+    struct tokenizer_context * tokenizer;
+    struct source * source;
+    struct token_block block;
+    struct token ring[TOKEN_STREAM_RING_SIZE];
+    unsigned int next_slot;
+    bool at_end;
+    const char * error; /* set when the stream ended on a lexer error */
+};
+
 void tokenizer_get_one_token(struct tokenizer_context * ctx, struct source * source, struct token * token);
-struct token * tokenizer_tokenize_file(struct tokenizer_context * ctx, struct source * source);
+void token_block_fill(struct token_block * block, struct tokenizer_context * tokenizer, struct source * source);
+void token_stream_init(struct token_stream * stream, struct tokenizer_context * tokenizer, struct source * source);
+struct token * token_stream_next(struct token_stream * stream);
 const char * token_stringify(const struct token * token);
 
 #endif /* CCLYNX_TOKENIZER_H */
@@ -7,72 +7,90 @@
 #include "allocator.h"
 #include "symbol.h"
 
-#define IDENTIFIER_TABLE_SIZE  (101)
-
-static struct keyword
-{
-    const char * name;
-    enum keyword_code code;
-} keywords[] = {
-    {"int",         KEYWORD_INT},
-    {"void",        KEYWORD_VOID},
-    {"return",      KEYWORD_RETURN},
-    {"while",       KEYWORD_WHILE},
-    {"if",          KEYWORD_IF},
-    {"else",        KEYWORD_ELSE},
-    {"unsigned",    KEYWORD_UNSIGNED}
+#define IDENTIFIER_TABLE_INITIAL_CAPACITY  (64)
+
+/* shared by every translation unit and thread, keywords never get symbols attached */
+static const struct identifier keywords[] = {
+    [KEYWORD_VOID] =        {"void",        NULL, KEYWORD_VOID},
+    [KEYWORD_INT] =         {"int",         NULL, KEYWORD_INT},
+    [KEYWORD_RETURN] =      {"return",      NULL, KEYWORD_RETURN},
+    [KEYWORD_WHILE] =       {"while",       NULL, KEYWORD_WHILE},
+    [KEYWORD_UNSIGNED] =    {"unsigned",    NULL, KEYWORD_UNSIGNED},
+    [KEYWORD_IF] =          {"if",          NULL, KEYWORD_IF},
+    [KEYWORD_ELSE] =        {"else",        NULL, KEYWORD_ELSE},
 };
 
 
-struct identifier * identifier_create(struct hashmap * identifier_table, struct memory_blob_pool * pool, const char * name)
+void identifier_table_init(struct hashmap * identifier_table, struct memory_blob_pool * pool)
 {
     assert(identifier_table != NULL);
     assert(pool != NULL);
+    hashmap_init(identifier_table, IDENTIFIER_TABLE_INITIAL_CAPACITY, pool);
+}
+
+/*
+ * Switches on the length and the first character, so most names are
+ * rejected without comparing any bytes, and keywords never reach the
+ * identifier table.
+ */
+const struct identifier * keyword_lookup(const char * name, unsigned int len)
+{
     assert(name != NULL);
-    size_t len = strlen(name);
-    struct identifier * existing = hashmap_find(identifier_table, name, len);
 
-    if (existing != NULL) {
-        return existing;
+    enum keyword_code code = KEYWORD_NONE;
+
+    switch (len) {
+        case 2:
+            code = name[0] == 'i' ? KEYWORD_IF : KEYWORD_NONE;
+            break;
+        case 3:
+            code = name[0] == 'i' ? KEYWORD_INT : KEYWORD_NONE;
+            break;
+        case 4:
+            code = name[0] == 'v' ? KEYWORD_VOID : name[0] == 'e' ? KEYWORD_ELSE : KEYWORD_NONE;
+            break;
+        case 5:
+            code = name[0] == 'w' ? KEYWORD_WHILE : KEYWORD_NONE;
+            break;
+        case 6:
+            code = name[0] == 'r' ? KEYWORD_RETURN : KEYWORD_NONE;
+            break;
+        case 8:
+            code = name[0] == 'u' ? KEYWORD_UNSIGNED : KEYWORD_NONE;
+            break;
     }
 
-    return identifier_insert(identifier_table, pool, name, len);
-}
+    if (code == KEYWORD_NONE || memcmp(name, keywords[code].name, len) != 0) {
+        return NULL;
+    }
 
-struct identifier * identifier_lookup(struct hashmap * identifier_table, const char * name, unsigned int len)
-{
-    assert(identifier_table != NULL);
-    assert(name != NULL);
-    return hashmap_find(identifier_table, name, len);
+    return &keywords[code];
 }
 
-struct identifier * identifier_insert(struct hashmap * identifier_table, struct memory_blob_pool * pool, const char * name, unsigned int len)
+struct identifier * identifier_intern(struct hashmap * identifier_table, struct memory_blob_pool * pool, const char * name, unsigned int len)
 {
     assert(identifier_table != NULL);
     assert(pool != NULL);
     assert(name != NULL);
-    struct identifier * identifier = memory_blob_pool_alloc(pool, sizeof(struct identifier));
 
-    identifier->name = memory_blob_pool_alloc(pool, len + 1);
-    memcpy(identifier->name, name, len);
-    identifier->name[len] = '\0';
+    bool inserted;
+    struct hashmap_entry * entry = hashmap_intern(identifier_table, name, len, hashmap_hash(name, len), &inserted);
 
-    hashmap_insert(identifier_table, identifier->name, identifier);
-    return identifier;
-}
+    if (!inserted) {
+        return entry->value;
+    }
 
-void init_keywords(struct hashmap * identifier_table, struct memory_blob_pool * pool)
-{
-    assert(identifier_table != NULL);
-    assert(pool != NULL);
-    hashmap_init(identifier_table, IDENTIFIER_TABLE_SIZE, pool);
+    struct identifier * identifier = memory_blob_pool_alloc_tagged(pool, sizeof(struct identifier), MEMORY_TAG_IDENTIFIERS);
+
+    identifier->name = memory_blob_pool_alloc_tagged(pool, len + 1, MEMORY_TAG_IDENTIFIERS);
+    memcpy(identifier->name, name, len);
+    identifier->name[len] = '\0';
 
-    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
-        const struct keyword * keyword = &keywords[i];
+    /* the entry was keyed by the caller's bytes, which may not outlive the table */
+    entry->key = identifier->name;
+    entry->value = identifier;
 
-        struct identifier * identifier = identifier_create(identifier_table, pool, keyword->name);
-        identifier->keyword_code = keyword->code;
-    }
+    return identifier;
 }
 
 void identifier_detach_symbol(struct identifier * identifier, const struct symbol * symbol)
@@ -80,14 +98,8 @@ void identifier_detach_symbol(struct identifier * identifier, const struct symbo
     assert(identifier != NULL);
     assert(symbol != NULL);
 
-    struct symbol_list ** it = &identifier->symbols;
-
-    while (*it != NULL) {
-        if ((*it)->symbol == symbol) {
-            *it = (*it)->next;
-            return;
-        }
+    /* scopes are left innermost first and newest symbol first, so it is always the top binding */
+    assert(identifier->symbols != NULL && identifier->symbols->symbol == symbol);
 
-        it = &(*it)->next;
-    }
+    identifier->symbols = identifier->symbols->next;
 }
@@ -1,20 +1,29 @@
 #include <assert.h>
+#include <memory.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "ir.h"
+#include "identifier.h"
 #include "allocator.h"
 #include "ast.h"
 #include "type.h"
 #include "symbol.h"
-#include "error.h"
 
-static struct ir_instruction * ir_create_instruction(struct ir_context * ctx, enum opcode code);
-static struct ir_operand * ir_create_operand(struct ir_context * ctx, enum operand_kind kind);
-static struct ir_operand * alloc_operand(struct ir_context * ctx);
+static struct ir_instruction ir_create_instruction(enum opcode code);
+static ir_operand_id ir_create_operand(struct ir_context * ctx, enum operand_kind kind);
+static struct ir_operand * ir_operand_at(const struct ir_context * ctx, ir_operand_id id);
 static void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const struct ast_node * node);
-static void ir_emit(struct ir_program * program, struct ir_instruction * instruction);
-static struct ir_operand * new_temporary_operand(struct ir_context * ctx);
-static void ir_generate_condition(struct ir_context * ctx, struct ir_program * program, struct ast_node * condition, struct ir_operand * jump_label);
+static void ir_emit_nop(struct ir_program * program);
+static ir_operand_id new_temporary_operand(struct ir_context * ctx, struct type * type);
+static ir_operand_id new_label_operand(struct ir_context * ctx);
+static ir_operand_id variable_operand(struct ir_context * ctx, struct symbol * symbol);
+static void ir_generate_condition(struct ir_context * ctx, struct ir_program * program, struct ast_node * condition, ir_operand_id jump_label);
+static void ir_report_error(struct ir_context * ctx, const char * message);
+static bool ir_expression_contains_call(const struct ast_node * node);
+static ir_operand_id new_frame_slot_operand(struct ir_context * ctx, struct type * type);
+static void ir_program_add_function(struct ir_program * program, struct ir_function * function);
+static uint32_t ir_constant_hash(long long int value, const struct type * type);
 
 void ir_context_init(struct ir_context * ctx, struct memory_blob_pool * pool)
 {
@@ -29,9 +38,16 @@ void ir_program_init(struct ir_program * program, struct memory_blob_pool * pool
     assert(program != NULL);
     assert(pool != NULL);
 
-    program->capacity = INITIAL_INSTRUCTION_COUNT;
+    program->chunks = NULL;
+    program->chunk_count = 0;
+    program->chunk_capacity = 0;
     program->position = 0;
-    program->instructions = memory_blob_pool_alloc(pool, program->capacity * sizeof(struct ir_instruction *));
+    program->functions = NULL;
+    program->function_count = 0;
+    program->function_capacity = 0;
+    program->temp_count = 0;
+    program->label_count = 0;
+    program->pool = pool;
 }
 
 void ir_program_generate(struct ir_context * ctx, struct ir_program * program, const struct ast_node * ast)
@@ -41,52 +57,47 @@ void ir_program_generate(struct ir_context * ctx, struct ir_program * program, c
     assert(ast != NULL);
 
     if (ast->kind != AST_NODE_KIND_FUNCTION_DEFINITION) {
-        cclynx_fatal_error("ERROR: expected function to generate it to IR\n");
+        ir_report_error(ctx, "ERROR: expected function to generate it to IR\n");
+        return;
     }
 
-    {
-        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_FUNC);
-
-        struct ir_operand * result = ir_create_operand(ctx, OPERAND_KIND_FUNCTION_NAME);
-        result->content.function.identifier = ast->content.function_definition.name;
+    struct ir_function * function = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct ir_function), MEMORY_TAG_IR_OPERANDS);
+    function->name = ast->content.function_definition.name;
+    function->begin = program->position;
+    ctx->function = function;
 
-        instruction->result = result;
+    {
+        struct ir_instruction instruction = ir_create_instruction(OP_FUNC);
 
-        ctx->current_func = instruction;
+        instruction.result = ir_create_operand(ctx, OPERAND_KIND_FUNCTION_NAME);
+        ir_operand_at(ctx, instruction.result)->content.function.identifier = function->name;
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     }
 
     for (unsigned int i = 0; i < ast->content.function_definition.parameter_count; i++) {
         struct ast_node * param = ast->content.function_definition.parameters[i];
-        struct symbol * param_symbol = param->content.symbol;
-
-        struct ir_operand * variable = alloc_operand(ctx);
-        variable->kind = OPERAND_KIND_VARIABLE;
-        variable->content.variable.symbol = param_symbol;
-        variable->content.variable.offset = ctx->current_func->result->content.function.local_vars_size;
-        variable->type = param_symbol->type;
-        param_symbol->ir_operand = variable;
-        ctx->current_func->result->content.function.local_vars_size += param_symbol->type->size;
 
-        struct ir_instruction * store_param = ir_create_instruction(ctx, OP_STORE_PARAM);
-        store_param->op1 = variable;
+        struct ir_instruction store_param = ir_create_instruction(OP_STORE_PARAM);
+        store_param.op1 = variable_operand(ctx, param->content.symbol);
+        store_param.op2 = ir_function_constant(function, ctx->pool, i, &type_sint32);
 
-        struct ir_operand * index = ir_create_operand(ctx, OPERAND_KIND_CONSTANT);
-        index->content.int_value = i;
-        store_param->op2 = index;
-
-        ir_emit(program, store_param);
+        ir_emit(program, &store_param);
     }
 
     do_generate_ir(ctx, program, ast->content.function_definition.body);
 
     {
-        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_FUNC_END);
-        instruction->result = ctx->current_func->result;
+        struct ir_instruction instruction = ir_create_instruction(OP_FUNC_END);
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     }
+
+    function->end = program->position;
+    ir_program_add_function(program, function);
+    program->temp_count = ctx->temp_id;
+    program->label_count = ctx->label_id;
+    ctx->function = NULL;
 }
 
 
@@ -99,11 +110,9 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
     switch(node->kind) {
         case AST_NODE_KIND_IF_STATEMENT:
             {
-                struct ir_operand * end_of_condition_label = NULL;
+                ir_operand_id end_of_condition_label = IR_OPERAND_NONE;
 
-                struct ir_operand * end_of_if_label = ir_create_operand(ctx, OPERAND_KIND_LABEL);
-                end_of_if_label->content.label_id = ++ctx->label_id;
-                end_of_if_label->type = &type_void;
+                ir_operand_id end_of_if_label = new_label_operand(ctx);
 
                 ir_generate_condition(ctx, program, node->content.if_statement.condition, end_of_if_label);
 
@@ -111,71 +120,62 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
                     node->content.if_statement.true_branch->kind == AST_NODE_KIND_EXPRESSION_STATEMENT
                     && node->content.if_statement.true_branch->content.node == NULL
                 ) {
-                    ir_emit(program, ir_create_instruction(ctx, OP_NOP));
+                    ir_emit_nop(program);
                 } else {
                     do_generate_ir(ctx, program, node->content.if_statement.true_branch);
                 }
 
                 if (node->content.if_statement.false_branch != NULL) {
-                    {
-                        struct ir_operand * end_label = ir_create_operand(ctx, OPERAND_KIND_LABEL);
-                        end_label->type = &type_void;
-                        end_label->content.label_id = ++ctx->label_id;
-                        end_of_condition_label = end_label;
-                    }
-                    {
-                        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_JUMP);
-                        instruction->op1 = end_of_condition_label;
+                    end_of_condition_label = new_label_operand(ctx);
+                    if (!ctx->skip_unreachable || !ast_statement_always_returns(node->content.if_statement.true_branch)) {
+                        struct ir_instruction instruction = ir_create_instruction(OP_JUMP);
+                        instruction.op1 = end_of_condition_label;
 
-                        ir_emit(program, instruction);
+                        ir_emit(program, &instruction);
                     }
                     {
-                        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_LABEL);
-                        instruction->op1 = end_of_if_label;
+                        struct ir_instruction instruction = ir_create_instruction(OP_LABEL);
+                        instruction.op1 = end_of_if_label;
 
-                        ir_emit(program, instruction);
+                        ir_emit(program, &instruction);
                     }
 
                     if (
                         node->content.if_statement.false_branch->kind == AST_NODE_KIND_EXPRESSION_STATEMENT
                         && node->content.if_statement.false_branch->content.node == NULL
                     ) {
-                        ir_emit(program, ir_create_instruction(ctx, OP_NOP));
+                        ir_emit_nop(program);
                     } else {
                         do_generate_ir(ctx, program, node->content.if_statement.false_branch);
                     }
                 }
 
-                if (end_of_condition_label != NULL) {
-                    struct ir_instruction * instruction = ir_create_instruction(ctx, OP_LABEL);
-                    instruction->op1 = end_of_condition_label;
+                if (end_of_condition_label != IR_OPERAND_NONE) {
+                    struct ir_instruction instruction = ir_create_instruction(OP_LABEL);
+                    instruction.op1 = end_of_condition_label;
 
-                    ir_emit(program, instruction);
+                    ir_emit(program, &instruction);
                 } else {
-                    struct ir_instruction * instruction = ir_create_instruction(ctx, OP_LABEL);
-                    instruction->op1 = end_of_if_label;
+                    struct ir_instruction instruction = ir_create_instruction(OP_LABEL);
+                    instruction.op1 = end_of_if_label;
 
-                    ir_emit(program, instruction);
+                    ir_emit(program, &instruction);
                 }
 
             }
             break;
         case AST_NODE_KIND_WHILE_STATEMENT:
             {
-                struct ir_operand * start_of_loop_label = ir_create_operand(ctx, OPERAND_KIND_LABEL);
-                start_of_loop_label->content.label_id = ++ctx->label_id;
-                start_of_loop_label->type = &type_void;
+                ir_operand_id start_of_loop_label = new_label_operand(ctx);
 
                 {
-                    struct ir_instruction * instruction = ir_create_instruction(ctx, OP_LABEL);
-                    instruction->op1 = start_of_loop_label;
+                    struct ir_instruction instruction = ir_create_instruction(OP_LABEL);
+                    instruction.op1 = start_of_loop_label;
 
-                    ir_emit(program, instruction);
+                    ir_emit(program, &instruction);
                 }
 
-                struct ir_operand * end_of_loop_label = ir_create_operand(ctx, OPERAND_KIND_LABEL);
-                end_of_loop_label->content.label_id = ++ctx->label_id;
-                end_of_loop_label->type = &type_void;
+                ir_operand_id end_of_loop_label = new_label_operand(ctx);
 
                 ir_generate_condition(ctx, program, node->content.while_statement.condition, end_of_loop_label);
 
@@ -183,39 +183,29 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
                     node->content.while_statement.body->kind == AST_NODE_KIND_EXPRESSION_STATEMENT
                     && node->content.while_statement.body->content.node == NULL
                 ) {
-                    ir_emit(program, ir_create_instruction(ctx, OP_NOP));
+                    ir_emit_nop(program);
                 } else {
                     do_generate_ir(ctx, program, node->content.while_statement.body);
                 }
 
                 {
-                    struct ir_instruction * instruction = ir_create_instruction(ctx, OP_JUMP);
-                    instruction->op1 = start_of_loop_label;
+                    struct ir_instruction instruction = ir_create_instruction(OP_JUMP);
+                    instruction.op1 = start_of_loop_label;
 
-                    ir_emit(program, instruction);
+                    ir_emit(program, &instruction);
                 }
 
                 {
-                    struct ir_instruction * instruction = ir_create_instruction(ctx, OP_LABEL);
-                    instruction->op1 = end_of_loop_label;
+                    struct ir_instruction instruction = ir_create_instruction(OP_LABEL);
+                    instruction.op1 = end_of_loop_label;
 
-                    ir_emit(program, instruction);
+                    ir_emit(program, &instruction);
                 }
             }
             break;
         case AST_NODE_KIND_VARIABLE_EXPRESSION:
             {
-                struct ir_operand * variable = node->content.symbol->ir_operand;
-
-                if (variable == NULL) {
-                    variable = alloc_operand(ctx);
-                    variable->kind = OPERAND_KIND_VARIABLE;
-                    variable->content.variable.symbol = node->content.symbol;
-                    variable->content.variable.offset = ctx->current_func->result->content.function.local_vars_size;
-                    variable->type = node->content.symbol->type;
-                    node->content.symbol->ir_operand = variable;
-                    ctx->current_func->result->content.function.local_vars_size += node->content.symbol->type->size;
-                }
+                ir_operand_id variable = variable_operand(ctx, node->content.symbol);
 
                 ctx->last_variable = variable;
 
@@ -223,13 +213,13 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
                     return;
                 }
 
-                struct ir_instruction * instruction = ir_create_instruction(ctx, OP_LOAD);
+                struct ir_instruction instruction = ir_create_instruction(OP_LOAD);
 
-                instruction->op1 = variable;
+                instruction.op1 = variable;
 
-                instruction->result = new_temporary_operand(ctx);
+                instruction.result = new_temporary_operand(ctx, node->type);
 
-                ir_emit(program, instruction);
+                ir_emit(program, &instruction);
             }
             break;
         case AST_NODE_KIND_EXPRESSION_STATEMENT:
@@ -243,14 +233,15 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
             break;
         case AST_NODE_KIND_ASSIGNMENT_EXPRESSION:
             {
-                struct ir_instruction * instruction = ir_create_instruction(ctx, OP_NOP);
+                struct ir_instruction instruction = ir_create_instruction(OP_NOP);
 
                 switch (node->content.assignment.type) {
                     case ASSIGNMENT_REGULAR:
-                        instruction->code = OP_STORE;
+                        instruction.code = OP_STORE;
                         break;
                     default:
-                        cclynx_fatal_error("ERROR: unknown assignment\n");
+                        ir_report_error(ctx, "ERROR: unknown assignment\n");
+                        break;
                 }
 
                 ctx->is_assign = 1;
@@ -259,12 +250,12 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
 
                 ctx->is_assign = 0;
 
-                instruction->op1 = ctx->last_variable;
+                instruction.op1 = ctx->last_variable;
 
                 do_generate_ir(ctx, program, node->content.assignment.initializer);
-                instruction->op2 = program->instructions[program->position - 1]->result;
+                instruction.op2 = ir_program_last(program)->result;
 
-                ir_emit(program, instruction);
+                ir_emit(program, &instruction);
             }
             break;
         case AST_NODE_KIND_VARIABLE_DECLARATION:
@@ -274,46 +265,47 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
         case AST_NODE_KIND_ADDITIVE_EXPRESSION:
         case AST_NODE_KIND_RELATIONAL_EXPRESSION:
             {
-                struct ir_instruction * instruction = ir_create_instruction(ctx, OP_NOP);
+                struct ir_instruction instruction = ir_create_instruction(OP_NOP);
 
                 switch (node->content.binary_expression.operation) {
                     case BINARY_OPERATION_MULTIPLY:
-                        instruction->code = OP_MUL;
+                        instruction.code = OP_MUL;
                         break;
                     case BINARY_OPERATION_DIVIDE:
-                        instruction->code = type_is_unsigned(node->type) ? OP_UNSIGNED_DIV : OP_DIV;
+                        instruction.code = type_is_unsigned(node->type) ? OP_UNSIGNED_DIV : OP_DIV;
                         break;
                     case BINARY_OPERATION_EQUALITY:
-                        instruction->code = OP_EQ;
+                        instruction.code = OP_EQ;
                         break;
                     case BINARY_OPERATION_INEQUALITY:
-                        instruction->code = OP_NE;
+                        instruction.code = OP_NE;
                         break;
                     case BINARY_OPERATION_LESS_THAN:
-                        instruction->code = type_is_unsigned(node->type) ? OP_UNSIGNED_LT : OP_LT;
+                        instruction.code = type_is_unsigned(node->type) ? OP_UNSIGNED_LT : OP_LT;
                         break;
                     case BINARY_OPERATION_GREATER_THAN:
-                        instruction->code = type_is_unsigned(node->type) ? OP_UNSIGNED_GT : OP_GT;
+                        instruction.code = type_is_unsigned(node->type) ? OP_UNSIGNED_GT : OP_GT;
                         break;
                     case BINARY_OPERATION_ADDITION:
-                        instruction->code = OP_ADD;
+                        instruction.code = OP_ADD;
                         break;
                     case BINARY_OPERATION_SUBTRACTION:
-                        instruction->code = OP_SUB;
+                        instruction.code = OP_SUB;
                         break;
                     default:
-                        cclynx_fatal_error("ERROR: unknown operation\n");
+                        ir_report_error(ctx, "ERROR: unknown operation\n");
+                        break;
                 }
 
                 do_generate_ir(ctx, program, node->content.binary_expression.lhs);
-                instruction->op1 = program->instructions[program->position - 1]->result;
+                instruction.op1 = ir_program_last(program)->result;
 
                 do_generate_ir(ctx, program, node->content.binary_expression.rhs);
-                instruction->op2 = program->instructions[program->position - 1]->result;
+                instruction.op2 = ir_program_last(program)->result;
 
-                instruction->result = new_temporary_operand(ctx);
+                instruction.result = new_temporary_operand(ctx, node->type);
 
-                ir_emit(program, instruction);
+                ir_emit(program, &instruction);
             }
             break;
         case AST_NODE_KIND_COMPOUND_STATEMENT:
@@ -321,11 +313,15 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
                 struct ast_node_list * it = node->content.list;
 
                 if (it == NULL) {
-                    ir_emit(program, ir_create_instruction(ctx, OP_NOP));
+                    ir_emit_nop(program);
                 } else {
                     while (it != NULL) {
                         do_generate_ir(ctx, program, it->node);
 
+                        if (ctx->skip_unreachable && ast_statement_always_returns(it->node)) {
+                            break;
+                        }
+
                         it = it->next;
                     }
                 }
@@ -333,188 +329,440 @@ void do_generate_ir(struct ir_context * ctx, struct ir_program * program, const
             break;
         case AST_NODE_KIND_RETURN_STATEMENT:
             {
-                struct ir_instruction * instruction = ir_create_instruction(ctx, OP_RETURN);
-                instruction->result = ctx->current_func->result;
+                struct ir_instruction instruction = ir_create_instruction(OP_RETURN);
 
                 if (node->content.node != NULL) {
                     do_generate_ir(ctx, program, node->content.node);
-                    instruction->op1 = program->instructions[program->position - 1]->result;
+                    instruction.op1 = ir_program_last(program)->result;
                 }
 
-                ir_emit(program, instruction);
+                ir_emit(program, &instruction);
             }
             break;
         case AST_NODE_KIND_INTEGER_CONSTANT_EXPRESSION:
             {
-                struct ir_instruction * instruction = ir_create_instruction(ctx, OP_CONST);
-
-                struct ir_operand * constant = ir_create_operand(ctx, OPERAND_KIND_CONSTANT);
-                constant->type = node->type;
-                constant->content.int_value = node->content.constant.value;
+                struct ir_instruction instruction = ir_create_instruction(OP_CONST);
 
-                instruction->op1 = constant;
-                instruction->result = new_temporary_operand(ctx);
+                instruction.op1 = ir_function_constant(ctx->function, ctx->pool, node->content.constant.value, node->type);
+                instruction.result = new_temporary_operand(ctx, node->type);
 
-                ir_emit(program, instruction);
+                ir_emit(program, &instruction);
             }
             break;
         case AST_NODE_KIND_FUNCTION_CALL_EXPRESSION:
             {
-                for (unsigned int i = 0; i < node->content.function_call.argument_count; i++) {
-                    do_generate_ir(ctx, program, node->content.function_call.arguments[i]);
+                unsigned int argument_count = node->content.function_call.argument_count;
 
-                    struct ir_instruction * arg_instruction = ir_create_instruction(ctx, OP_ARG);
-                    arg_instruction->op1 = program->instructions[program->position - 1]->result;
+                ir_operand_id callee_id = ir_create_operand(ctx, OPERAND_KIND_FUNCTION_NAME);
+                struct ir_operand * callee = ir_operand_at(ctx, callee_id);
+                callee->content.function.identifier = node->content.function_call.function->identifier;
 
-                    struct ir_operand * index = ir_create_operand(ctx, OPERAND_KIND_CONSTANT);
-                    index->content.int_value = i;
-                    arg_instruction->op2 = index;
+                /*
+                 * Arguments are moved into w0-w7 as soon as they are evaluated unless a later
+                 * call could clobber them, the rest are staged in the frame until the call.
+                 */
+                unsigned int staged_from = argument_count < IR_REGISTER_ARGUMENT_COUNT ? argument_count : IR_REGISTER_ARGUMENT_COUNT;
+                for (unsigned int i = 0; i < argument_count; i++) {
+                    if (ir_expression_contains_call(node->content.function_call.arguments[i])) {
+                        staged_from = 0;
+                        break;
+                    }
+                }
 
-                    ir_emit(program, arg_instruction);
+                if (staged_from < argument_count) {
+                    callee->content.function.staged_arguments = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(ir_operand_id) * argument_count, MEMORY_TAG_IR_OPERANDS);
                 }
 
-                struct ir_instruction * call_instruction = ir_create_instruction(ctx, OP_CALL);
+                for (unsigned int i = 0; i < argument_count; i++) {
+                    do_generate_ir(ctx, program, node->content.function_call.arguments[i]);
+
+                    struct ir_instruction arg_instruction = ir_create_instruction(OP_ARG);
+                    arg_instruction.op1 = ir_program_last(program)->result;
 
-                struct ir_operand * callee = ir_create_operand(ctx, OPERAND_KIND_FUNCTION_NAME);
-                callee->content.function.identifier = node->content.function_call.function->identifier;
-                call_instruction->op1 = callee;
+                    arg_instruction.op2 = ir_function_constant(ctx->function, ctx->pool, i, &type_sint32);
 
-                call_instruction->result = new_temporary_operand(ctx);
-                call_instruction->result->type = node->type;
+                    if (i >= staged_from) {
+                        arg_instruction.result = new_frame_slot_operand(ctx, node->content.function_call.arguments[i]->type);
+                        callee->content.function.staged_arguments[i] = arg_instruction.result;
+                    }
 
-                ir_emit(program, call_instruction);
+                    ir_emit(program, &arg_instruction);
+                }
+
+                struct ir_instruction call_instruction = ir_create_instruction(OP_CALL);
+                call_instruction.op1 = callee_id;
+                call_instruction.op2 = ir_function_constant(ctx->function, ctx->pool, argument_count, &type_sint32);
+
+                call_instruction.result = new_temporary_operand(ctx, node->type);
+
+                ir_emit(program, &call_instruction);
             }
             break;
         default:
-            cclynx_fatal_error("ERROR: unknown ast node for IR generator\n");
+            ir_report_error(ctx, "ERROR: unknown ast node for IR generator\n");
+            break;
+    }
+}
+
+/* generation goes on so the caller finds the first error once it is done */
+void ir_report_error(struct ir_context * ctx, const char * message)
+{
+    if (ctx->error == NULL) {
+        ctx->error = message;
     }
 }
 
-void ir_emit(struct ir_program * program, struct ir_instruction * instruction)
+/* copies the instruction to the end of the program, the stored copy never moves */
+struct ir_instruction * ir_emit(struct ir_program * program, const struct ir_instruction * instruction)
 {
     assert(program != NULL);
     assert(instruction != NULL);
 
-    if (program->position == program->capacity) {
-        cclynx_fatal_error("ERROR: too many instructions\n");
+    if (program->position == program->chunk_count * IR_INSTRUCTION_CHUNK_SIZE) {
+        if (program->chunk_count == program->chunk_capacity) {
+            size_t chunk_capacity = program->chunk_capacity > 0 ? program->chunk_capacity * 2 : IR_INITIAL_CHUNK_CAPACITY;
+            struct ir_instruction ** chunks = memory_blob_pool_alloc_tagged(program->pool, sizeof(struct ir_instruction *) * chunk_capacity, MEMORY_TAG_IR_INSTRUCTIONS);
+            if (program->chunk_count > 0) {
+                memcpy(chunks, program->chunks, sizeof(struct ir_instruction *) * program->chunk_count);
+            }
+            program->chunks = chunks;
+            program->chunk_capacity = chunk_capacity;
+        }
+        program->chunks[program->chunk_count++] = memory_blob_pool_alloc_tagged(program->pool, sizeof(struct ir_instruction) * IR_INSTRUCTION_CHUNK_SIZE, MEMORY_TAG_IR_INSTRUCTIONS);
     }
 
-    program->instructions[program->position++] = instruction;
+    struct ir_instruction * stored = ir_program_at(program, program->position++);
+    *stored = *instruction;
+    return stored;
 }
 
-struct ir_instruction * ir_create_instruction(struct ir_context * ctx, enum opcode code)
+void ir_emit_nop(struct ir_program * program)
 {
-    assert(ctx != NULL);
-    struct ir_instruction * instruction = memory_blob_pool_alloc(ctx->pool, sizeof(struct ir_instruction));
-    instruction->code = code;
+    struct ir_instruction instruction = ir_create_instruction(OP_NOP);
+    ir_emit(program, &instruction);
+}
+
+struct ir_instruction ir_create_instruction(enum opcode code)
+{
+    struct ir_instruction instruction;
+    memset(&instruction, 0, sizeof(struct ir_instruction));
+    instruction.code = code;
     return instruction;
 }
 
-struct ir_operand * ir_create_operand(struct ir_context * ctx, enum operand_kind kind)
+ir_operand_id ir_function_add_operand(struct ir_function * function, struct memory_blob_pool * pool, enum operand_kind kind)
 {
-    assert(ctx != NULL);
-    struct ir_operand * operand = memory_blob_pool_alloc(ctx->pool, sizeof(struct ir_operand));
+    assert(function != NULL);
+    assert(pool != NULL);
+
+    struct ir_operand_table * table = &function->operands;
+
+    if (table->count == 0) {
+        table->count = 1; /* IR_OPERAND_NONE */
+    }
+
+    ir_operand_id id = table->count;
+    uint32_t chunk = 31 - __builtin_clz((id >> IR_OPERAND_FIRST_CHUNK_SHIFT) + 1);
+
+    /* the caller checks ir_program_exhausted_function once the function is built */
+    if (chunk >= IR_OPERAND_CHUNK_COUNT) {
+        table->exhausted = true;
+        return id - 1;
+    }
+
+    if (table->chunks[chunk] == NULL) {
+        size_t chunk_size = (size_t) 1 << (IR_OPERAND_FIRST_CHUNK_SHIFT + chunk);
+        table->chunks[chunk] = memory_blob_pool_alloc_tagged(pool, sizeof(struct ir_operand) * chunk_size, MEMORY_TAG_IR_OPERANDS);
+    }
+
+    ++table->count;
+
+    struct ir_operand * operand = ir_function_operand(function, id);
     operand->kind = kind;
-    return operand;
+    return id;
+}
+
+uint32_t ir_constant_hash(long long int value, const struct type * type)
+{
+    uint64_t key = (uint64_t) value ^ ((uint64_t) (uintptr_t) type >> 3);
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (uint32_t) (key >> 32);
 }
 
-struct ir_operand * new_temporary_operand(struct ir_context * ctx)
+/* constants are immutable, so every use of the same value and type shares one operand */
+ir_operand_id ir_function_constant(struct ir_function * function, struct memory_blob_pool * pool, long long int value, struct type * type)
+{
+    assert(function != NULL);
+    assert(pool != NULL);
+
+    struct ir_operand_table * table = &function->operands;
+
+    if ((table->constant_count + 1) * 2 > table->constant_capacity) {
+        uint32_t capacity = table->constant_capacity > 0 ? table->constant_capacity * 2 : IR_CONSTANT_TABLE_INITIAL_CAPACITY;
+        ir_operand_id * constants = memory_blob_pool_alloc_tagged(pool, sizeof(ir_operand_id) * capacity, MEMORY_TAG_IR_OPERANDS);
+
+        for (uint32_t i = 0; i < table->constant_capacity; ++i) {
+            ir_operand_id id = table->constants[i];
+            if (id == IR_OPERAND_NONE) {
+                continue;
+            }
+            const struct ir_operand * constant = ir_function_operand(function, id);
+            uint32_t slot = ir_constant_hash(constant->content.int_value, constant->type) & (capacity - 1);
+            while (constants[slot] != IR_OPERAND_NONE) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            constants[slot] = id;
+        }
+
+        table->constants = constants;
+        table->constant_capacity = capacity;
+    }
+
+    uint32_t mask = table->constant_capacity - 1;
+    uint32_t slot = ir_constant_hash(value, type) & mask;
+
+    while (table->constants[slot] != IR_OPERAND_NONE) {
+        const struct ir_operand * constant = ir_function_operand(function, table->constants[slot]);
+        if (constant->content.int_value == value && constant->type == type) {
+            return table->constants[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    ir_operand_id id = ir_function_add_operand(function, pool, OPERAND_KIND_CONSTANT);
+    struct ir_operand * constant = ir_function_operand(function, id);
+    constant->content.int_value = value;
+    constant->type = type;
+
+    table->constants[slot] = id;
+    ++table->constant_count;
+
+    return id;
+}
+
+const struct ir_function * ir_program_exhausted_function(const struct ir_program * program)
+{
+    assert(program != NULL);
+
+    for (size_t i = 0; i < program->function_count; ++i) {
+        if (program->functions[i]->operands.exhausted) {
+            return program->functions[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* for passes that run after generation, the numbering continues where the generator stopped */
+ir_operand_id ir_function_new_temporary(struct ir_program * program, struct ir_function * function, struct type * type)
+{
+    assert(program != NULL);
+    assert(function != NULL);
+    ir_operand_id result = ir_function_add_operand(function, program->pool, OPERAND_KIND_TEMPORARY);
+    struct ir_operand * operand = ir_function_operand(function, result);
+    operand->content.temp_id = ++program->temp_count;
+    operand->type = type;
+    return result;
+}
+
+ir_operand_id ir_function_new_label(struct ir_program * program, struct ir_function * function)
+{
+    assert(program != NULL);
+    assert(function != NULL);
+    ir_operand_id label = ir_function_add_operand(function, program->pool, OPERAND_KIND_LABEL);
+    struct ir_operand * operand = ir_function_operand(function, label);
+    operand->content.label_id = ++program->label_count;
+    operand->type = &type_void;
+    return label;
+}
+
+ir_operand_id ir_create_operand(struct ir_context * ctx, enum operand_kind kind)
+{
+    assert(ctx != NULL);
+    assert(ctx->function != NULL);
+    return ir_function_add_operand(ctx->function, ctx->pool, kind);
+}
+
+struct ir_operand * ir_operand_at(const struct ir_context * ctx, ir_operand_id id)
+{
+    assert(ctx != NULL);
+    assert(ctx->function != NULL);
+    return ir_function_operand(ctx->function, id);
+}
+
+ir_operand_id new_temporary_operand(struct ir_context * ctx, struct type * type)
 {
     assert(ctx != NULL);
-    struct ir_operand * result = ir_create_operand(ctx, OPERAND_KIND_TEMPORARY);
-    result->content.temp_id = ++ctx->temp_id;
+    ir_operand_id result = ir_create_operand(ctx, OPERAND_KIND_TEMPORARY);
+    struct ir_operand * operand = ir_operand_at(ctx, result);
+    operand->content.temp_id = ++ctx->temp_id;
+    operand->type = type;
     return result;
 }
 
-struct ir_operand * alloc_operand(struct ir_context * ctx)
+ir_operand_id new_label_operand(struct ir_context * ctx)
 {
     assert(ctx != NULL);
-    if (ctx->operand_pos >= IR_MAX_OPERAND_COUNT) {
-        cclynx_fatal_error("ERROR: too many operands!\n");
+    ir_operand_id label = ir_create_operand(ctx, OPERAND_KIND_LABEL);
+    struct ir_operand * operand = ir_operand_at(ctx, label);
+    operand->content.label_id = ++ctx->label_id;
+    operand->type = &type_void;
+    return label;
+}
+
+/* a variable gets its frame slot and operand on first use, later uses share it */
+ir_operand_id variable_operand(struct ir_context * ctx, struct symbol * symbol)
+{
+    assert(ctx != NULL);
+    assert(symbol != NULL);
+
+    if (symbol->ir_operand != IR_OPERAND_NONE) {
+        return symbol->ir_operand;
+    }
+
+    ir_operand_id variable = ir_create_operand(ctx, OPERAND_KIND_VARIABLE);
+    struct ir_operand * operand = ir_operand_at(ctx, variable);
+    operand->content.variable.symbol = symbol;
+    operand->content.variable.offset = ctx->function->local_vars_size;
+    operand->type = symbol->type;
+    ctx->function->local_vars_size += symbol->type->size;
+
+    symbol->ir_operand = variable;
+    return variable;
+}
+
+ir_operand_id new_frame_slot_operand(struct ir_context * ctx, struct type * type)
+{
+    assert(ctx != NULL);
+    assert(type != NULL);
+    ir_operand_id slot = ir_create_operand(ctx, OPERAND_KIND_VARIABLE);
+    struct ir_operand * operand = ir_operand_at(ctx, slot);
+    operand->content.variable.offset = ctx->function->local_vars_size;
+    operand->type = type;
+    ctx->function->local_vars_size += type->size;
+    return slot;
+}
+
+void ir_program_add_function(struct ir_program * program, struct ir_function * function)
+{
+    assert(program != NULL);
+    assert(function != NULL);
+
+    if (program->function_count == program->function_capacity) {
+        size_t capacity = program->function_capacity > 0 ? program->function_capacity * 2 : IR_INITIAL_CHUNK_CAPACITY;
+        struct ir_function ** functions = memory_blob_pool_alloc_tagged(program->pool, sizeof(struct ir_function *) * capacity, MEMORY_TAG_IR_INSTRUCTIONS);
+        if (program->function_count > 0) {
+            memcpy(functions, program->functions, sizeof(struct ir_function *) * program->function_count);
+        }
+        program->functions = functions;
+        program->function_capacity = capacity;
     }
-    struct ir_operand * operand = &ctx->operands[ctx->operand_pos++];
-    memset(operand, 0, sizeof(struct ir_operand));
-    return operand;
+
+    program->functions[program->function_count++] = function;
 }
 
+bool ir_expression_contains_call(const struct ast_node * node)
+{
+    if (node == NULL) {
+        return false;
+    }
+
+    switch (node->kind) {
+        case AST_NODE_KIND_FUNCTION_CALL_EXPRESSION:
+            return true;
+        case AST_NODE_KIND_CAST_EXPRESSION:
+            return ir_expression_contains_call(node->content.node);
+        case AST_NODE_KIND_ASSIGNMENT_EXPRESSION:
+            return ir_expression_contains_call(node->content.assignment.lhs)
+                || ir_expression_contains_call(node->content.assignment.initializer);
+        case AST_NODE_KIND_MULTIPLICATIVE_EXPRESSION:
+        case AST_NODE_KIND_ADDITIVE_EXPRESSION:
+        case AST_NODE_KIND_RELATIONAL_EXPRESSION:
+        case AST_NODE_KIND_EQUALITY_EXPRESSION:
+            return ir_expression_contains_call(node->content.binary_expression.lhs)
+                || ir_expression_contains_call(node->content.binary_expression.rhs);
+        default:
+            return false;
+    }
+}
 
-void ir_generate_condition(struct ir_context * ctx, struct ir_program * program, struct ast_node * condition, struct ir_operand * jump_label)
+void ir_generate_condition(struct ir_context * ctx, struct ir_program * program, struct ast_node * condition, ir_operand_id jump_label)
 {
     assert(ctx != NULL);
     assert(program != NULL);
     assert(condition != NULL);
 
-    struct ir_operand * op1 = NULL, * op2 = NULL;
+    ir_operand_id op1 = IR_OPERAND_NONE, op2 = IR_OPERAND_NONE;
 
     if (
         condition->kind == AST_NODE_KIND_RELATIONAL_EXPRESSION
         && condition->content.binary_expression.operation == BINARY_OPERATION_LESS_THAN
     ) {
         do_generate_ir(ctx, program, condition->content.binary_expression.lhs);
-        op1 = program->instructions[program->position - 1]->result;
+        op1 = ir_program_last(program)->result;
         do_generate_ir(ctx, program, condition->content.binary_expression.rhs);
-        op2 = program->instructions[program->position - 1]->result;
+        op2 = ir_program_last(program)->result;
 
         enum opcode jump_op = type_is_unsigned(condition->type) ? OP_JUMP_IF_UNSIGNED_GTE : OP_JUMP_IF_GTE;
-        struct ir_instruction * instruction = ir_create_instruction(ctx, jump_op);
-        instruction->op1 = op1;
-        instruction->op2 = op2;
-        instruction->result = jump_label;
+        struct ir_instruction instruction = ir_create_instruction(jump_op);
+        instruction.op1 = op1;
+        instruction.op2 = op2;
+        instruction.result = jump_label;
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     } else if (
         condition->kind == AST_NODE_KIND_RELATIONAL_EXPRESSION
         && condition->content.binary_expression.operation == BINARY_OPERATION_GREATER_THAN
     ) {
         do_generate_ir(ctx, program, condition->content.binary_expression.lhs);
-        op1 = program->instructions[program->position - 1]->result;
+        op1 = ir_program_last(program)->result;
         do_generate_ir(ctx, program, condition->content.binary_expression.rhs);
-        op2 = program->instructions[program->position - 1]->result;
+        op2 = ir_program_last(program)->result;
 
         enum opcode jump_op = type_is_unsigned(condition->type) ? OP_JUMP_IF_UNSIGNED_LTE : OP_JUMP_IF_LTE;
-        struct ir_instruction * instruction = ir_create_instruction(ctx, jump_op);
-        instruction->op1 = op1;
-        instruction->op2 = op2;
-        instruction->result = jump_label;
+        struct ir_instruction instruction = ir_create_instruction(jump_op);
+        instruction.op1 = op1;
+        instruction.op2 = op2;
+        instruction.result = jump_label;
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     } else if (
         condition->kind == AST_NODE_KIND_EQUALITY_EXPRESSION
         && condition->content.binary_expression.operation == BINARY_OPERATION_EQUALITY
     ) {
         do_generate_ir(ctx, program, condition->content.binary_expression.lhs);
-        op1 = program->instructions[program->position - 1]->result;
+        op1 = ir_program_last(program)->result;
         do_generate_ir(ctx, program, condition->content.binary_expression.rhs);
-        op2 = program->instructions[program->position - 1]->result;
+        op2 = ir_program_last(program)->result;
 
-        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_JUMP_IF_NE);
-        instruction->op1 = op1;
-        instruction->op2 = op2;
-        instruction->result = jump_label;
+        struct ir_instruction instruction = ir_create_instruction(OP_JUMP_IF_NE);
+        instruction.op1 = op1;
+        instruction.op2 = op2;
+        instruction.result = jump_label;
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     } else if (
         condition->kind == AST_NODE_KIND_EQUALITY_EXPRESSION
         && condition->content.binary_expression.operation == BINARY_OPERATION_INEQUALITY
     ) {
         do_generate_ir(ctx, program, condition->content.binary_expression.lhs);
-        op1 = program->instructions[program->position - 1]->result;
+        op1 = ir_program_last(program)->result;
         do_generate_ir(ctx, program, condition->content.binary_expression.rhs);
-        op2 = program->instructions[program->position - 1]->result;
+        op2 = ir_program_last(program)->result;
 
-        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_JUMP_IF_EQ);
-        instruction->op1 = op1;
-        instruction->op2 = op2;
-        instruction->result = jump_label;
+        struct ir_instruction instruction = ir_create_instruction(OP_JUMP_IF_EQ);
+        instruction.op1 = op1;
+        instruction.op2 = op2;
+        instruction.result = jump_label;
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     } else {
         do_generate_ir(ctx, program, condition);
 
-        struct ir_instruction * instruction = ir_create_instruction(ctx, OP_JUMP_IF_FALSE);
-        instruction->op1 = program->instructions[program->position - 1]->result;
-        instruction->op2 = jump_label;
+        struct ir_instruction instruction = ir_create_instruction(OP_JUMP_IF_FALSE);
+        instruction.op1 = ir_program_last(program)->result;
+        instruction.op2 = jump_label;
 
-        ir_emit(program, instruction);
+        ir_emit(program, &instruction);
     }
 }
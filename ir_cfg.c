@@ -0,0 +1,343 @@
+#include <assert.h>
+#include <string.h>
+
+#include "ir_cfg.h"
+#include "ir.h"
+#include "allocator.h"
+
+static bool is_terminator(enum opcode code);
+static bool starts_block(const struct ir_program * program, const struct ir_function * function, size_t index);
+static uint32_t jump_target(const struct ir_instruction * instruction);
+static void add_successor(struct ir_basic_block * block, uint32_t successor);
+static void link_blocks(struct ir_cfg * cfg, const struct ir_program * program, const uint32_t * label_blocks, struct memory_blob_pool * pool);
+static void compute_reverse_postorder(struct ir_cfg * cfg, struct memory_blob_pool * pool);
+static void compute_dominators(struct ir_cfg * cfg);
+static uint32_t intersect(const struct ir_cfg * cfg, uint32_t a, uint32_t b);
+static void compute_loops(struct ir_cfg * cfg, struct memory_blob_pool * pool);
+
+/*
+ * Splits the function into basic blocks and computes the edges, the
+ * dominator tree and the loop nesting. Everything is allocated from the pool.
+ */
+void ir_cfg_build(struct ir_cfg * cfg, const struct ir_program * program, const struct ir_function * function, struct memory_blob_pool * pool)
+{
+    assert(cfg != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+    assert(pool != NULL);
+    assert(function->end > function->begin);
+
+    memset(cfg, 0, sizeof(struct ir_cfg));
+    cfg->function = function;
+
+    for (size_t i = function->begin; i < function->end; ++i) {
+        if (starts_block(program, function, i)) {
+            ++cfg->block_count;
+        }
+    }
+
+    cfg->blocks = memory_blob_pool_alloc_tagged(pool, sizeof(struct ir_basic_block) * cfg->block_count, MEMORY_TAG_CFG);
+    memset(cfg->blocks, 0, sizeof(struct ir_basic_block) * cfg->block_count);
+
+    uint32_t operand_count = function->operands.count > 0 ? function->operands.count : 1;
+    uint32_t * label_blocks = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * operand_count, MEMORY_TAG_CFG);
+    memset(label_blocks, 0xFF, sizeof(uint32_t) * operand_count);
+
+    uint32_t block = 0;
+
+    for (size_t i = function->begin; i < function->end; ++i) {
+        const struct ir_instruction * instruction = ir_program_at(program, i);
+
+        if (starts_block(program, function, i)) {
+            if (i != function->begin) {
+                cfg->blocks[block++].end = i;
+            }
+            cfg->blocks[block].begin = i;
+            cfg->blocks[block].immediate_dominator = IR_CFG_NO_BLOCK;
+            cfg->blocks[block].loop_header = IR_CFG_NO_BLOCK;
+            cfg->blocks[block].rpo_index = IR_CFG_NO_BLOCK;
+        }
+
+        if (instruction->code == OP_LABEL) {
+            label_blocks[instruction->op1] = block;
+        }
+    }
+
+    cfg->blocks[block].end = function->end;
+
+    link_blocks(cfg, program, label_blocks, pool);
+    compute_reverse_postorder(cfg, pool);
+    compute_dominators(cfg);
+    compute_loops(cfg, pool);
+}
+
+bool ir_cfg_dominates(const struct ir_cfg * cfg, uint32_t dominator, uint32_t block)
+{
+    assert(cfg != NULL);
+    assert(dominator < cfg->block_count);
+    assert(block < cfg->block_count);
+
+    if (!ir_cfg_is_reachable(cfg, block)) {
+        return false;
+    }
+
+    while (block != IR_CFG_NO_BLOCK) {
+        if (block == dominator) {
+            return true;
+        }
+        block = cfg->blocks[block].immediate_dominator;
+    }
+
+    return false;
+}
+
+bool is_terminator(enum opcode code)
+{
+    switch (code) {
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_LTE:
+        case OP_JUMP_IF_GTE:
+        case OP_JUMP_IF_UNSIGNED_LTE:
+        case OP_JUMP_IF_UNSIGNED_GTE:
+        case OP_JUMP_IF_NE:
+        case OP_JUMP_IF_EQ:
+        case OP_RETURN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool starts_block(const struct ir_program * program, const struct ir_function * function, size_t index)
+{
+    if (index == function->begin) {
+        return true;
+    }
+
+    /* OP_FUNC_END only marks the end of the range and stays with the last block */
+    enum opcode code = ir_program_at(program, index)->code;
+    return code == OP_LABEL || (code != OP_FUNC_END && is_terminator(ir_program_at(program, index - 1)->code));
+}
+
+/* the label operand a jump goes to, OP_JUMP_IF_FALSE keeps it in op2 and the compare-and-jumps in result */
+uint32_t jump_target(const struct ir_instruction * instruction)
+{
+    switch (instruction->code) {
+        case OP_JUMP:
+            return instruction->op1;
+        case OP_JUMP_IF_FALSE:
+            return instruction->op2;
+        default:
+            return instruction->result;
+    }
+}
+
+void add_successor(struct ir_basic_block * block, uint32_t successor)
+{
+    for (uint32_t i = 0; i < block->successor_count; ++i) {
+        if (block->successors[i] == successor) {
+            return;
+        }
+    }
+    assert(block->successor_count < IR_CFG_MAX_SUCCESSORS);
+    block->successors[block->successor_count++] = successor;
+}
+
+void link_blocks(struct ir_cfg * cfg, const struct ir_program * program, const uint32_t * label_blocks, struct memory_blob_pool * pool)
+{
+    uint32_t edge_count = 0;
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        struct ir_basic_block * block = &cfg->blocks[b];
+        const struct ir_instruction * last = ir_program_at(program, block->end - 1);
+
+        if (last->code == OP_FUNC_END && block->end - 1 > block->begin) {
+            last = ir_program_at(program, block->end - 2);
+        }
+
+        switch (last->code) {
+            case OP_RETURN:
+            case OP_FUNC_END:
+                break;
+            case OP_JUMP:
+                add_successor(block, label_blocks[jump_target(last)]);
+                break;
+            default:
+                if (b + 1 < cfg->block_count) {
+                    add_successor(block, b + 1);
+                }
+                if (is_terminator(last->code)) {
+                    add_successor(block, label_blocks[jump_target(last)]);
+                }
+                break;
+        }
+
+        for (uint32_t i = 0; i < block->successor_count; ++i) {
+            assert(block->successors[i] != IR_CFG_NO_BLOCK);
+            ++cfg->blocks[block->successors[i]].predecessor_count;
+        }
+        edge_count += block->successor_count;
+    }
+
+    uint32_t * predecessors = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * (edge_count > 0 ? edge_count : 1), MEMORY_TAG_CFG);
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        cfg->blocks[b].predecessors = predecessors;
+        predecessors += cfg->blocks[b].predecessor_count;
+        cfg->blocks[b].predecessor_count = 0;
+    }
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        const struct ir_basic_block * block = &cfg->blocks[b];
+        for (uint32_t i = 0; i < block->successor_count; ++i) {
+            struct ir_basic_block * successor = &cfg->blocks[block->successors[i]];
+            successor->predecessors[successor->predecessor_count++] = b;
+        }
+    }
+}
+
+/* iterative depth-first search from the entry, a block is numbered once all its successors are */
+void compute_reverse_postorder(struct ir_cfg * cfg, struct memory_blob_pool * pool)
+{
+    uint32_t * stack = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * cfg->block_count, MEMORY_TAG_CFG);
+    uint32_t * next_successor = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * cfg->block_count, MEMORY_TAG_CFG);
+    uint32_t * postorder = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * cfg->block_count, MEMORY_TAG_CFG);
+    uint32_t postorder_count = 0;
+    uint32_t depth = 0;
+
+    memset(next_successor, 0, sizeof(uint32_t) * cfg->block_count);
+
+    /* rpo_index doubles as the visited mark until the numbering below */
+    cfg->blocks[0].rpo_index = 0;
+    stack[depth++] = 0;
+
+    while (depth > 0) {
+        uint32_t b = stack[depth - 1];
+        struct ir_basic_block * block = &cfg->blocks[b];
+
+        if (next_successor[b] < block->successor_count) {
+            uint32_t successor = block->successors[next_successor[b]++];
+            if (cfg->blocks[successor].rpo_index == IR_CFG_NO_BLOCK) {
+                cfg->blocks[successor].rpo_index = 0;
+                stack[depth++] = successor;
+            }
+            continue;
+        }
+
+        postorder[postorder_count++] = b;
+        --depth;
+    }
+
+    cfg->reverse_postorder = stack;
+    cfg->reachable_count = postorder_count;
+
+    for (uint32_t i = 0; i < postorder_count; ++i) {
+        uint32_t b = postorder[postorder_count - 1 - i];
+        cfg->reverse_postorder[i] = b;
+        cfg->blocks[b].rpo_index = i;
+    }
+}
+
+/* Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm" */
+void compute_dominators(struct ir_cfg * cfg)
+{
+    cfg->blocks[0].immediate_dominator = 0;
+
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (uint32_t i = 1; i < cfg->reachable_count; ++i) {
+            uint32_t b = cfg->reverse_postorder[i];
+            struct ir_basic_block * block = &cfg->blocks[b];
+            uint32_t new_dominator = IR_CFG_NO_BLOCK;
+
+            for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+                uint32_t predecessor = block->predecessors[p];
+                if (cfg->blocks[predecessor].immediate_dominator == IR_CFG_NO_BLOCK) {
+                    continue;
+                }
+                new_dominator = new_dominator == IR_CFG_NO_BLOCK ? predecessor : intersect(cfg, predecessor, new_dominator);
+            }
+
+            if (block->immediate_dominator != new_dominator) {
+                block->immediate_dominator = new_dominator;
+                changed = true;
+            }
+        }
+    }
+
+    cfg->blocks[0].immediate_dominator = IR_CFG_NO_BLOCK;
+}
+
+uint32_t intersect(const struct ir_cfg * cfg, uint32_t a, uint32_t b)
+{
+    while (a != b) {
+        while (cfg->blocks[a].rpo_index > cfg->blocks[b].rpo_index) {
+            a = cfg->blocks[a].immediate_dominator;
+        }
+        while (cfg->blocks[b].rpo_index > cfg->blocks[a].rpo_index) {
+            b = cfg->blocks[b].immediate_dominator;
+        }
+    }
+    return a;
+}
+
+/*
+ * Every edge into a block that dominates its source closes a natural loop.
+ * Headers are visited in reverse postorder, so an inner header always comes
+ * after the loops around it and ends up as the innermost one.
+ */
+void compute_loops(struct ir_cfg * cfg, struct memory_blob_pool * pool)
+{
+    uint32_t * marks = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * cfg->block_count, MEMORY_TAG_CFG);
+    uint32_t * worklist = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * cfg->block_count, MEMORY_TAG_CFG);
+
+    memset(marks, 0xFF, sizeof(uint32_t) * cfg->block_count);
+
+    for (uint32_t i = 0; i < cfg->reachable_count; ++i) {
+        uint32_t header = cfg->reverse_postorder[i];
+        const struct ir_basic_block * header_block = &cfg->blocks[header];
+        uint32_t count = 0;
+        bool is_header = false;
+
+        marks[header] = header;
+
+        for (uint32_t p = 0; p < header_block->predecessor_count; ++p) {
+            uint32_t latch = header_block->predecessors[p];
+            if (!ir_cfg_dominates(cfg, header, latch)) {
+                continue;
+            }
+            is_header = true;
+            if (marks[latch] != header) {
+                marks[latch] = header;
+                worklist[count++] = latch;
+            }
+        }
+
+        if (!is_header) {
+            continue;
+        }
+
+        cfg->blocks[header].loop_header = header;
+        ++cfg->blocks[header].loop_depth;
+
+        while (count > 0) {
+            uint32_t b = worklist[--count];
+            struct ir_basic_block * block = &cfg->blocks[b];
+
+            block->loop_header = header;
+            ++block->loop_depth;
+
+            for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+                uint32_t predecessor = block->predecessors[p];
+                if (ir_cfg_is_reachable(cfg, predecessor) && marks[predecessor] != header) {
+                    marks[predecessor] = header;
+                    worklist[count++] = predecessor;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,375 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "optimizer.h"
+#include "ir.h"
+#include "ir_cfg.h"
+#include "allocator.h"
+
+static void drop_unreachable_blocks(struct optimizer_context * ctx, const struct ir_program * program, const struct ir_function * function, const struct ir_cfg * cfg, bool * dropped, uint32_t * next_stores);
+static void prune_phis(struct optimizer_context * ctx, const struct ir_program * program, const struct ir_function * function, const struct ir_cfg * cfg, bool * dropped);
+static ir_operand_id block_tag(const struct ir_program * program, const struct ir_cfg * cfg, uint32_t block);
+static void mark_live(struct optimizer_context * ctx, const struct ir_program * program, const struct ir_function * function, bool * dropped, const uint32_t * next_stores);
+static void mark(struct optimizer_context * ctx, const struct ir_function * function, ir_operand_id id, ir_operand_id * stack, uint32_t * count);
+static void sweep(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function, const bool * dropped);
+static bool is_pure_definition(enum opcode code);
+static bool is_local_store(const struct ir_function * function, const struct ir_instruction * instruction);
+static ir_operand_id jump_label(const struct ir_instruction * instruction);
+static bool jumps_to_next(const struct ir_program * program, const struct ir_function * function, const bool * dropped, size_t index, ir_operand_id label);
+
+/*
+ * Removes the blocks no path from the entry reaches, the definitions no live
+ * instruction reads, stores to variables no live load reads and OP_NOP.
+ * Liveness is marked from the instructions with effects, so a cycle of phis
+ * feeding only each other goes away as well. The use counts hold the live
+ * marks of temporaries, the loaded marks of variables and the references to
+ * labels, their operand IDs never overlap. The definitions of a variable are
+ * the head of the list of its stores.
+ */
+void ir_dce_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    optimizer_prepare_function(ctx, function);
+
+    struct ir_cfg cfg;
+    ir_cfg_build(&cfg, program, function, ctx->scratch);
+
+    size_t length = function->end - function->begin;
+    bool * dropped = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(bool) * length, MEMORY_TAG_CFG);
+    uint32_t * next_stores = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(uint32_t) * length, MEMORY_TAG_CFG);
+    memset(dropped, 0, sizeof(bool) * length);
+
+    drop_unreachable_blocks(ctx, program, function, &cfg, dropped, next_stores);
+    prune_phis(ctx, program, function, &cfg, dropped);
+    mark_live(ctx, program, function, dropped, next_stores);
+    sweep(ctx, program, function, dropped);
+}
+
+/* OP_FUNC_END stays, it shares the last block */
+void drop_unreachable_blocks(struct optimizer_context * ctx, const struct ir_program * program, const struct ir_function * function, const struct ir_cfg * cfg, bool * dropped, uint32_t * next_stores)
+{
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        const struct ir_basic_block * block = &cfg->blocks[b];
+        bool reachable = ir_cfg_is_reachable(cfg, b);
+
+        for (size_t index = block->begin; index < block->end; ++index) {
+            const struct ir_instruction * instruction = ir_program_at(program, index);
+
+            if (!reachable) {
+                dropped[index - function->begin] = instruction->code != OP_FUNC_END;
+                continue;
+            }
+
+            if (instruction->result != IR_OPERAND_NONE && instruction->result < ctx->operand_count) {
+                ctx->definitions[instruction->result] = (uint32_t) (index - function->begin);
+            }
+            if (is_local_store(function, instruction)) {
+                next_stores[index - function->begin] = ctx->definitions[instruction->op1];
+                ctx->definitions[instruction->op1] = (uint32_t) (index - function->begin);
+            }
+        }
+
+        if (!reachable) {
+            ++ctx->stats.unreachable_blocks;
+        }
+    }
+}
+
+/*
+ * A phi forgets the arguments of predecessors that are gone, and one left
+ * with a single value besides itself is replaced by that value. Replacing a
+ * phi can leave another one with a single value, hence the repeat.
+ */
+void prune_phis(struct optimizer_context * ctx, const struct ir_program * program, const struct ir_function * function, const struct ir_cfg * cfg, bool * dropped)
+{
+    bool any_phis = false;
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        const struct ir_basic_block * block = &cfg->blocks[b];
+
+        if (!ir_cfg_is_reachable(cfg, b)) {
+            continue;
+        }
+
+        for (size_t index = block->begin; index < block->end; ++index) {
+            const struct ir_instruction * instruction = ir_program_at(program, index);
+
+            if (instruction->code != OP_PHI) {
+                continue;
+            }
+
+            any_phis = true;
+            struct phi * phi = &ir_function_operand(function, instruction->op1)->content.phi;
+            uint32_t count = 0;
+
+            for (uint32_t i = 0; i < phi->count; ++i) {
+                bool incoming = false;
+                for (uint32_t p = 0; p < block->predecessor_count && !incoming; ++p) {
+                    uint32_t predecessor = block->predecessors[p];
+                    incoming = ir_cfg_is_reachable(cfg, predecessor) && block_tag(program, cfg, predecessor) == phi->predecessors[i];
+                }
+                if (incoming) {
+                    phi->values[count] = phi->values[i];
+                    phi->predecessors[count++] = phi->predecessors[i];
+                }
+            }
+
+            phi->count = count;
+        }
+    }
+
+    bool changed = any_phis;
+
+    while (changed) {
+        changed = false;
+
+        for (size_t index = function->begin; index < function->end; ++index) {
+            const struct ir_instruction * instruction = ir_program_at(program, index);
+
+            if (instruction->code != OP_PHI || dropped[index - function->begin]) {
+                continue;
+            }
+
+            struct phi * phi = &ir_function_operand(function, instruction->op1)->content.phi;
+            ir_operand_id same = IR_OPERAND_NONE;
+            bool trivial = true;
+
+            for (uint32_t i = 0; i < phi->count && trivial; ++i) {
+                phi->values[i] = optimizer_resolve_alias(ctx, phi->values[i]);
+                if (phi->values[i] == instruction->result || phi->values[i] == same) {
+                    continue;
+                }
+                trivial = same == IR_OPERAND_NONE;
+                same = phi->values[i];
+            }
+
+            if (trivial && same != IR_OPERAND_NONE) {
+                ctx->aliases[instruction->result] = same;
+                dropped[index - function->begin] = true;
+                ++ctx->stats.dead_instructions;
+                changed = true;
+            }
+        }
+    }
+}
+
+ir_operand_id block_tag(const struct ir_program * program, const struct ir_cfg * cfg, uint32_t block)
+{
+    const struct ir_instruction * first = ir_program_at(program, cfg->blocks[block].begin);
+
+    if (block == 0) {
+        return first->result;
+    }
+    return first->code == OP_LABEL ? first->op1 : IR_OPERAND_NONE;
+}
+
+/*
+ * The instructions with effects are the roots, marking a temporary marks the
+ * operands of its definition. A store to a local variable only becomes live
+ * with the first live load of the variable. A jump to the label right after
+ * it is not a root either, the condition it tested can go with it.
+ */
+void mark_live(struct optimizer_context * ctx, const struct ir_program * program, const struct ir_function * function, bool * dropped, const uint32_t * next_stores)
+{
+    ir_operand_id * stack = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(ir_operand_id) * ctx->operand_count, MEMORY_TAG_IR_OPERANDS);
+    uint32_t count = 0;
+
+    for (size_t index = function->begin; index < function->end; ++index) {
+        const struct ir_instruction * instruction = ir_program_at(program, index);
+
+        if (dropped[index - function->begin] || is_pure_definition(instruction->code)) {
+            continue;
+        }
+
+        if (instruction->code == OP_NOP) {
+            dropped[index - function->begin] = true;
+            ++ctx->stats.nops;
+            continue;
+        }
+
+        if (is_local_store(function, instruction)) {
+            continue;
+        }
+
+        ir_operand_id label = jump_label(instruction);
+        if (label != IR_OPERAND_NONE) {
+            if (jumps_to_next(program, function, dropped, index, label)) {
+                dropped[index - function->begin] = true;
+                ++ctx->stats.branches;
+                continue;
+            }
+            ++ctx->use_counts[label];
+        }
+
+        mark(ctx, function, instruction->op1, stack, &count);
+        mark(ctx, function, instruction->op2, stack, &count);
+    }
+
+    while (count > 0) {
+        ir_operand_id id = stack[--count];
+        uint32_t definition = ctx->definitions[id];
+
+        if (definition == UINT32_MAX) {
+            continue;
+        }
+
+        const struct ir_instruction * instruction = ir_program_at(program, function->begin + definition);
+
+        if (instruction->code == OP_LOAD && ir_function_operand(function, instruction->op1)->content.variable.symbol != NULL) {
+            ir_operand_id variable = instruction->op1;
+            if (ctx->use_counts[variable] == 0) {
+                ctx->use_counts[variable] = 1;
+                for (uint32_t store = ctx->definitions[variable]; store != UINT32_MAX; store = next_stores[store]) {
+                    mark(ctx, function, ir_program_at(program, function->begin + store)->op2, stack, &count);
+                }
+            }
+            continue;
+        }
+
+        if (instruction->code != OP_PHI) {
+            mark(ctx, function, instruction->op1, stack, &count);
+            mark(ctx, function, instruction->op2, stack, &count);
+            continue;
+        }
+
+        const struct phi * phi = &ir_function_operand(function, instruction->op1)->content.phi;
+        for (uint32_t i = 0; i < phi->count; ++i) {
+            mark(ctx, function, phi->values[i], stack, &count);
+            ++ctx->use_counts[phi->predecessors[i]];
+        }
+    }
+}
+
+/* the aliases of replaced phis are resolved here, the sweep rewrites the operands the same way */
+void mark(struct optimizer_context * ctx, const struct ir_function * function, ir_operand_id id, ir_operand_id * stack, uint32_t * count)
+{
+    id = optimizer_resolve_alias(ctx, id);
+
+    if (id == IR_OPERAND_NONE || id >= ctx->operand_count || ctx->use_counts[id] != 0) {
+        return;
+    }
+
+    if (ir_function_operand(function, id)->kind != OPERAND_KIND_TEMPORARY) {
+        return;
+    }
+
+    ctx->use_counts[id] = 1;
+    stack[(*count)++] = id;
+}
+
+/* a label no jump or phi refers to any more goes, joining its block with the one before */
+void sweep(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function, const bool * dropped)
+{
+    size_t kept = function->begin;
+
+    for (size_t index = function->begin; index < function->end; ++index) {
+        struct ir_instruction instruction = *ir_program_at(program, index);
+
+        if (dropped[index - function->begin]) {
+            continue;
+        }
+
+        if (is_pure_definition(instruction.code) && ctx->use_counts[instruction.result] == 0) {
+            ++ctx->stats.dead_instructions;
+            continue;
+        }
+
+        if (is_local_store(function, &instruction) && ctx->use_counts[instruction.op1] == 0) {
+            ++ctx->stats.dead_instructions;
+            continue;
+        }
+
+        if (instruction.code == OP_LABEL && ctx->use_counts[instruction.op1] == 0) {
+            ++ctx->stats.branches;
+            continue;
+        }
+
+        if (instruction.code == OP_PHI) {
+            struct phi * phi = &ir_function_operand(function, instruction.op1)->content.phi;
+            for (uint32_t i = 0; i < phi->count; ++i) {
+                phi->values[i] = optimizer_resolve_alias(ctx, phi->values[i]);
+            }
+        } else {
+            instruction.op1 = optimizer_resolve_alias(ctx, instruction.op1);
+            instruction.op2 = optimizer_resolve_alias(ctx, instruction.op2);
+        }
+
+        *ir_program_at(program, kept++) = instruction;
+    }
+
+    function->end = kept;
+}
+
+bool is_pure_definition(enum opcode code)
+{
+    switch (code) {
+        case OP_CONST:
+        case OP_LOAD:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_UNSIGNED_DIV:
+        case OP_LT:
+        case OP_GT:
+        case OP_UNSIGNED_LT:
+        case OP_UNSIGNED_GT:
+        case OP_EQ:
+        case OP_NE:
+        case OP_PHI:
+        case OP_PARAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* argument staging slots have no symbol, the call reads them without an OP_LOAD */
+bool is_local_store(const struct ir_function * function, const struct ir_instruction * instruction)
+{
+    if (instruction->code != OP_STORE && instruction->code != OP_STORE_PARAM) {
+        return false;
+    }
+
+    return ir_function_operand(function, instruction->op1)->content.variable.symbol != NULL;
+}
+
+/* the label operand a jump goes to, OP_JUMP_IF_FALSE keeps it in op2 and the compare-and-jumps in result */
+ir_operand_id jump_label(const struct ir_instruction * instruction)
+{
+    switch (instruction->code) {
+        case OP_JUMP:
+            return instruction->op1;
+        case OP_JUMP_IF_FALSE:
+            return instruction->op2;
+        case OP_JUMP_IF_LTE:
+        case OP_JUMP_IF_GTE:
+        case OP_JUMP_IF_UNSIGNED_LTE:
+        case OP_JUMP_IF_UNSIGNED_GTE:
+        case OP_JUMP_IF_NE:
+        case OP_JUMP_IF_EQ:
+            return instruction->result;
+        default:
+            return IR_OPERAND_NONE;
+    }
+}
+
+/* only unreachable blocks and OP_NOP can sit between a jump and the next label, both are going */
+bool jumps_to_next(const struct ir_program * program, const struct ir_function * function, const bool * dropped, size_t index, ir_operand_id label)
+{
+    for (size_t next = index + 1; next < function->end; ++next) {
+        const struct ir_instruction * instruction = ir_program_at(program, next);
+
+        if (dropped[next - function->begin] || instruction->code == OP_NOP) {
+            continue;
+        }
+        return instruction->code == OP_LABEL && instruction->op1 == label;
+    }
+
+    return false;
+}
@@ -0,0 +1,329 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "optimizer.h"
+#include "ir.h"
+#include "type.h"
+
+static bool fold_instruction(struct optimizer_context * ctx, struct ir_function * function, struct ir_instruction * instruction);
+static bool simplify_identity(struct optimizer_context * ctx, struct ir_function * function, struct ir_instruction * instruction, bool lhs_known, uint32_t lhs, bool rhs_known, uint32_t rhs);
+static bool fold_binary(enum opcode code, uint32_t lhs, uint32_t rhs, uint32_t * value);
+static bool fold_jump_condition(enum opcode code, uint32_t lhs, uint32_t rhs);
+static bool constant_value(const struct optimizer_context * ctx, const struct ir_function * function, ir_operand_id id, uint32_t * value);
+static void replace_with_constant(struct optimizer_context * ctx, struct ir_function * function, struct ir_instruction * instruction, uint32_t value);
+static bool is_pure_definition(enum opcode code);
+static void remove_dead_definitions(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+static void count_uses(struct optimizer_context * ctx, const struct ir_function * function, const struct ir_instruction * instruction, int delta);
+static void count_use(struct optimizer_context * ctx, ir_operand_id id, int delta);
+
+/*
+ * Folds instructions whose operands are known constants with the 32-bit
+ * semantics of int and unsigned int, removes arithmetic identities and
+ * turns conditional jumps on constants into OP_JUMP or nothing.
+ */
+void ir_fold_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    optimizer_prepare_function(ctx, function);
+
+    size_t kept = function->begin;
+
+    for (size_t i = function->begin; i < function->end; ++i) {
+        struct ir_instruction instruction = *ir_program_at(program, i);
+        if (fold_instruction(ctx, function, &instruction)) {
+            *ir_program_at(program, kept++) = instruction;
+        }
+    }
+
+    function->end = kept;
+
+    remove_dead_definitions(ctx, program, function);
+}
+
+/* returns false when the instruction is dropped */
+bool fold_instruction(struct optimizer_context * ctx, struct ir_function * function, struct ir_instruction * instruction)
+{
+    instruction->op1 = optimizer_resolve_alias(ctx, instruction->op1);
+    instruction->op2 = optimizer_resolve_alias(ctx, instruction->op2);
+
+    uint32_t lhs = 0;
+    uint32_t rhs = 0;
+    bool lhs_known = constant_value(ctx, function, instruction->op1, &lhs);
+    bool rhs_known = constant_value(ctx, function, instruction->op2, &rhs);
+
+    switch (instruction->code) {
+        case OP_CONST:
+            ctx->constants[instruction->result] = instruction->op1;
+            return true;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_UNSIGNED_DIV:
+        case OP_LT:
+        case OP_GT:
+        case OP_UNSIGNED_LT:
+        case OP_UNSIGNED_GT:
+        case OP_EQ:
+        case OP_NE:
+            {
+                uint32_t value = 0;
+                if (lhs_known && rhs_known && fold_binary(instruction->code, lhs, rhs, &value)) {
+                    replace_with_constant(ctx, function, instruction, value);
+                    return true;
+                }
+                return simplify_identity(ctx, function, instruction, lhs_known, lhs, rhs_known, rhs);
+            }
+        case OP_JUMP_IF_FALSE:
+            if (!lhs_known) {
+                return true;
+            }
+            if (lhs != 0) {
+                return false;
+            }
+            instruction->code = OP_JUMP;
+            instruction->op1 = instruction->op2;
+            instruction->op2 = IR_OPERAND_NONE;
+            return true;
+        case OP_JUMP_IF_LTE:
+        case OP_JUMP_IF_GTE:
+        case OP_JUMP_IF_UNSIGNED_LTE:
+        case OP_JUMP_IF_UNSIGNED_GTE:
+        case OP_JUMP_IF_NE:
+        case OP_JUMP_IF_EQ:
+            if (!lhs_known || !rhs_known) {
+                return true;
+            }
+            if (!fold_jump_condition(instruction->code, lhs, rhs)) {
+                return false;
+            }
+            instruction->code = OP_JUMP;
+            instruction->op1 = instruction->result;
+            instruction->op2 = IR_OPERAND_NONE;
+            instruction->result = IR_OPERAND_NONE;
+            return true;
+        default:
+            return true;
+    }
+}
+
+/* x + 0, x - 0, x * 1 and x / 1 become x, x * 0 and x - x become 0 */
+bool simplify_identity(struct optimizer_context * ctx, struct ir_function * function, struct ir_instruction * instruction, bool lhs_known, uint32_t lhs, bool rhs_known, uint32_t rhs)
+{
+    ir_operand_id same = IR_OPERAND_NONE;
+
+    switch (instruction->code) {
+        case OP_ADD:
+            if (rhs_known && rhs == 0) {
+                same = instruction->op1;
+            } else if (lhs_known && lhs == 0) {
+                same = instruction->op2;
+            }
+            break;
+        case OP_SUB:
+            if (rhs_known && rhs == 0) {
+                same = instruction->op1;
+            } else if (instruction->op1 == instruction->op2) {
+                replace_with_constant(ctx, function, instruction, 0);
+            }
+            break;
+        case OP_MUL:
+            if ((rhs_known && rhs == 0) || (lhs_known && lhs == 0)) {
+                replace_with_constant(ctx, function, instruction, 0);
+            } else if (rhs_known && rhs == 1) {
+                same = instruction->op1;
+            } else if (lhs_known && lhs == 1) {
+                same = instruction->op2;
+            }
+            break;
+        case OP_DIV:
+        case OP_UNSIGNED_DIV:
+            if (rhs_known && rhs == 1) {
+                same = instruction->op1;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (same == IR_OPERAND_NONE) {
+        return true;
+    }
+
+    ctx->aliases[instruction->result] = same;
+    return false;
+}
+
+bool fold_binary(enum opcode code, uint32_t lhs, uint32_t rhs, uint32_t * value)
+{
+    switch (code) {
+        case OP_ADD:
+            *value = lhs + rhs;
+            return true;
+        case OP_SUB:
+            *value = lhs - rhs;
+            return true;
+        case OP_MUL:
+            *value = lhs * rhs;
+            return true;
+        case OP_DIV:
+            /* division by zero and INT_MIN / -1 are left for run time */
+            if (rhs == 0 || (lhs == UINT32_C(0x80000000) && rhs == UINT32_MAX)) {
+                return false;
+            }
+            *value = (uint32_t) ((int32_t) lhs / (int32_t) rhs);
+            return true;
+        case OP_UNSIGNED_DIV:
+            if (rhs == 0) {
+                return false;
+            }
+            *value = lhs / rhs;
+            return true;
+        case OP_LT:
+            *value = (int32_t) lhs < (int32_t) rhs;
+            return true;
+        case OP_GT:
+            *value = (int32_t) lhs > (int32_t) rhs;
+            return true;
+        case OP_UNSIGNED_LT:
+            *value = lhs < rhs;
+            return true;
+        case OP_UNSIGNED_GT:
+            *value = lhs > rhs;
+            return true;
+        case OP_EQ:
+            *value = lhs == rhs;
+            return true;
+        case OP_NE:
+            *value = lhs != rhs;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* whether the jump is taken */
+bool fold_jump_condition(enum opcode code, uint32_t lhs, uint32_t rhs)
+{
+    switch (code) {
+        case OP_JUMP_IF_LTE:
+            return (int32_t) lhs <= (int32_t) rhs;
+        case OP_JUMP_IF_GTE:
+            return (int32_t) lhs >= (int32_t) rhs;
+        case OP_JUMP_IF_UNSIGNED_LTE:
+            return lhs <= rhs;
+        case OP_JUMP_IF_UNSIGNED_GTE:
+            return lhs >= rhs;
+        case OP_JUMP_IF_NE:
+            return lhs != rhs;
+        case OP_JUMP_IF_EQ:
+            return lhs == rhs;
+        default:
+            assert(0 && "not a conditional jump");
+            return false;
+    }
+}
+
+bool constant_value(const struct optimizer_context * ctx, const struct ir_function * function, ir_operand_id id, uint32_t * value)
+{
+    if (id == IR_OPERAND_NONE || id >= ctx->operand_count || ctx->constants[id] == IR_OPERAND_NONE) {
+        return false;
+    }
+    *value = (uint32_t) ir_function_operand(function, ctx->constants[id])->content.int_value;
+    return true;
+}
+
+void replace_with_constant(struct optimizer_context * ctx, struct ir_function * function, struct ir_instruction * instruction, uint32_t value)
+{
+    struct type * type = ir_function_operand(function, instruction->result)->type;
+    if (type == NULL) {
+        type = &type_sint32;
+    }
+
+    long long int int_value = type_is_unsigned(type) ? (long long int) value : (long long int) (int32_t) value;
+
+    instruction->code = OP_CONST;
+    instruction->op1 = ir_function_constant(function, ctx->pool, int_value, type);
+    instruction->op2 = IR_OPERAND_NONE;
+    ctx->constants[instruction->result] = instruction->op1;
+}
+
+bool is_pure_definition(enum opcode code)
+{
+    switch (code) {
+        case OP_CONST:
+        case OP_LOAD:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_UNSIGNED_DIV:
+        case OP_LT:
+        case OP_GT:
+        case OP_UNSIGNED_LT:
+        case OP_UNSIGNED_GT:
+        case OP_EQ:
+        case OP_NE:
+        case OP_PHI:
+        case OP_PARAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Drops pure definitions nobody reads any more, such as the constants a fold
+ * consumed. Walking backwards frees whole chains in one pass, the survivors
+ * are packed towards the end of the range. A phi can read a value defined
+ * further down, so its arguments only get their aliases resolved here.
+ */
+void remove_dead_definitions(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    for (size_t i = function->begin; i < function->end; ++i) {
+        const struct ir_instruction * instruction = ir_program_at(program, i);
+        count_uses(ctx, function, instruction, 1);
+    }
+
+    size_t kept = function->end;
+
+    for (size_t i = function->end; i-- > function->begin;) {
+        const struct ir_instruction * instruction = ir_program_at(program, i);
+
+        if (is_pure_definition(instruction->code) && ctx->use_counts[instruction->result] == 0) {
+            count_uses(ctx, function, instruction, -1);
+            continue;
+        }
+
+        *ir_program_at(program, --kept) = *instruction;
+    }
+
+    function->begin = kept;
+}
+
+void count_uses(struct optimizer_context * ctx, const struct ir_function * function, const struct ir_instruction * instruction, int delta)
+{
+    if (instruction->code != OP_PHI) {
+        count_use(ctx, instruction->op1, delta);
+        count_use(ctx, instruction->op2, delta);
+        return;
+    }
+
+    struct phi * phi = &ir_function_operand(function, instruction->op1)->content.phi;
+    for (uint32_t i = 0; i < phi->count; ++i) {
+        phi->values[i] = optimizer_resolve_alias(ctx, phi->values[i]);
+        count_use(ctx, phi->values[i], delta);
+    }
+}
+
+/* constants made while folding come after the prepared range, they are never definitions */
+void count_use(struct optimizer_context * ctx, ir_operand_id id, int delta)
+{
+    if (id < ctx->operand_count) {
+        ctx->use_counts[id] += (uint32_t) delta;
+    }
+}
@@ -0,0 +1,303 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "optimizer.h"
+#include "ir.h"
+#include "ir_cfg.h"
+#include "allocator.h"
+
+#define GVN_NO_ENTRY (UINT32_MAX)
+
+/* an expression with the temporary holding its value, OP_LOAD entries map a variable to its current value */
+struct gvn_entry
+{
+    enum opcode code;
+    ir_operand_id op1;
+    ir_operand_id op2;
+    ir_operand_id value;
+    uint32_t block;
+    uint32_t next; /* next entry of the same bucket, entries are only ever removed from the top */
+};
+
+struct gvn_table
+{
+    struct gvn_entry * entries; /* a stack, the entries of the blocks on the current dominator tree path */
+    uint32_t entry_count;
+    uint32_t * buckets;
+    uint32_t bucket_mask;
+};
+
+static void number_block(struct optimizer_context * ctx, struct ir_program * program, const struct ir_cfg * cfg, struct gvn_table * table, uint32_t b);
+static bool number_instruction(struct optimizer_context * ctx, struct gvn_table * table, struct ir_instruction * instruction, uint32_t b);
+static bool is_numbered(enum opcode code);
+static void canonicalize(enum opcode * code, ir_operand_id * op1, ir_operand_id * op2);
+static uint32_t hash_key(enum opcode code, ir_operand_id op1, ir_operand_id op2);
+static const struct gvn_entry * find(const struct gvn_table * table, enum opcode code, ir_operand_id op1, ir_operand_id op2);
+static void insert(struct gvn_table * table, enum opcode code, ir_operand_id op1, ir_operand_id op2, ir_operand_id value, uint32_t b);
+static void resolve_phis(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+
+/*
+ * Value numbering over the dominator tree: an expression computed again in a
+ * block its first computation dominates reads the earlier temporary instead,
+ * the recomputation is left for dead code elimination. Temporaries have one
+ * definition in and out of SSA form, so an entry stays valid in the whole
+ * subtree. Loads and constants only match inside their block, a load because
+ * a store on another path could come in between and a constant because
+ * materializing it again is cheaper than the register it would hold.
+ */
+void ir_gvn_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    optimizer_prepare_function(ctx, function);
+
+    struct ir_cfg cfg;
+    ir_cfg_build(&cfg, program, function, ctx->scratch);
+
+    uint32_t block_count = cfg.block_count;
+    struct memory_blob_pool * pool = ctx->scratch;
+    size_t length = function->end - function->begin;
+
+    struct gvn_table table;
+    table.entries = memory_blob_pool_alloc_tagged(pool, sizeof(struct gvn_entry) * length, MEMORY_TAG_CFG);
+    table.entry_count = 0;
+
+    uint32_t bucket_count = 16;
+    while (bucket_count < length) {
+        bucket_count *= 2;
+    }
+    table.buckets = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * bucket_count, MEMORY_TAG_CFG);
+    table.bucket_mask = bucket_count - 1;
+    memset(table.buckets, 0xFF, sizeof(uint32_t) * bucket_count);
+
+    uint32_t * child_counts = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * (block_count + 1), MEMORY_TAG_CFG);
+    uint32_t * children = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    uint32_t * stack = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    uint32_t * entry_marks = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    uint32_t * next_child = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+
+    memset(child_counts, 0, sizeof(uint32_t) * (block_count + 1));
+
+    for (uint32_t b = 0; b < block_count; ++b) {
+        uint32_t dominator = cfg.blocks[b].immediate_dominator;
+        if (dominator != IR_CFG_NO_BLOCK) {
+            ++child_counts[dominator + 1];
+        }
+    }
+    for (uint32_t b = 0; b < block_count; ++b) {
+        child_counts[b + 1] += child_counts[b];
+        next_child[b] = child_counts[b];
+    }
+    for (uint32_t b = 0; b < block_count; ++b) {
+        uint32_t dominator = cfg.blocks[b].immediate_dominator;
+        if (dominator != IR_CFG_NO_BLOCK) {
+            children[next_child[dominator]++] = b;
+        }
+    }
+    for (uint32_t b = 0; b < block_count; ++b) {
+        next_child[b] = child_counts[b];
+    }
+
+    uint32_t depth = 0;
+    stack[depth++] = 0;
+    entry_marks[0] = table.entry_count;
+    number_block(ctx, program, &cfg, &table, 0);
+
+    while (depth > 0) {
+        uint32_t b = stack[depth - 1];
+
+        if (next_child[b] < child_counts[b + 1]) {
+            uint32_t child = children[next_child[b]++];
+            entry_marks[child] = table.entry_count;
+            number_block(ctx, program, &cfg, &table, child);
+            stack[depth++] = child;
+            continue;
+        }
+
+        while (table.entry_count > entry_marks[b]) {
+            const struct gvn_entry * entry = &table.entries[--table.entry_count];
+            table.buckets[hash_key(entry->code, entry->op1, entry->op2) & table.bucket_mask] = entry->next;
+        }
+        --depth;
+    }
+
+    resolve_phis(ctx, program, function);
+}
+
+/* the dominators of the block are numbered already, so every operand defined there has its final alias */
+void number_block(struct optimizer_context * ctx, struct ir_program * program, const struct ir_cfg * cfg, struct gvn_table * table, uint32_t b)
+{
+    const struct ir_basic_block * block = &cfg->blocks[b];
+
+    for (size_t index = block->begin; index < block->end; ++index) {
+        struct ir_instruction * instruction = ir_program_at(program, index);
+
+        if (instruction->code != OP_PHI) {
+            instruction->op1 = optimizer_resolve_alias(ctx, instruction->op1);
+            instruction->op2 = optimizer_resolve_alias(ctx, instruction->op2);
+        }
+
+        if (!number_instruction(ctx, table, instruction, b)) {
+            ++ctx->stats.redundant_instructions;
+        }
+    }
+}
+
+/* returns false when the instruction computes a value some temporary already holds */
+bool number_instruction(struct optimizer_context * ctx, struct gvn_table * table, struct ir_instruction * instruction, uint32_t b)
+{
+    const struct gvn_entry * entry;
+
+    switch (instruction->code) {
+        case OP_LOAD:
+            entry = find(table, OP_LOAD, instruction->op1, IR_OPERAND_NONE);
+            if (entry != NULL && entry->block == b && entry->value != IR_OPERAND_NONE) {
+                ctx->aliases[instruction->result] = entry->value;
+                return false;
+            }
+            insert(table, OP_LOAD, instruction->op1, IR_OPERAND_NONE, instruction->result, b);
+            return true;
+        case OP_STORE:
+            insert(table, OP_LOAD, instruction->op1, IR_OPERAND_NONE, instruction->op2, b);
+            return true;
+        case OP_STORE_PARAM:
+            insert(table, OP_LOAD, instruction->op1, IR_OPERAND_NONE, IR_OPERAND_NONE, b);
+            return true;
+        case OP_CONST:
+            entry = find(table, OP_CONST, instruction->op1, IR_OPERAND_NONE);
+            if (entry != NULL && entry->block == b) {
+                ctx->aliases[instruction->result] = entry->value;
+                return false;
+            }
+            insert(table, OP_CONST, instruction->op1, IR_OPERAND_NONE, instruction->result, b);
+            return true;
+        default:
+            break;
+    }
+
+    if (!is_numbered(instruction->code)) {
+        return true;
+    }
+
+    enum opcode code = instruction->code;
+    ir_operand_id op1 = instruction->op1;
+    ir_operand_id op2 = instruction->op2;
+    canonicalize(&code, &op1, &op2);
+
+    entry = find(table, code, op1, op2);
+    if (entry != NULL) {
+        ctx->aliases[instruction->result] = entry->value;
+        return false;
+    }
+
+    insert(table, code, op1, op2, instruction->result, b);
+    return true;
+}
+
+bool is_numbered(enum opcode code)
+{
+    switch (code) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_UNSIGNED_DIV:
+        case OP_LT:
+        case OP_GT:
+        case OP_UNSIGNED_LT:
+        case OP_UNSIGNED_GT:
+        case OP_EQ:
+        case OP_NE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* a + b and b + a get the same key, and so do a > b and b < a */
+void canonicalize(enum opcode * code, ir_operand_id * op1, ir_operand_id * op2)
+{
+    ir_operand_id swap;
+
+    switch (*code) {
+        case OP_GT:
+            *code = OP_LT;
+            break;
+        case OP_UNSIGNED_GT:
+            *code = OP_UNSIGNED_LT;
+            break;
+        case OP_ADD:
+        case OP_MUL:
+        case OP_EQ:
+        case OP_NE:
+            if (*op1 <= *op2) {
+                return;
+            }
+            break;
+        default:
+            return;
+    }
+
+    swap = *op1;
+    *op1 = *op2;
+    *op2 = swap;
+}
+
+uint32_t hash_key(enum opcode code, ir_operand_id op1, ir_operand_id op2)
+{
+    uint32_t hash = (uint32_t) code * UINT32_C(0x9E3779B1);
+    hash = (hash ^ op1) * UINT32_C(0x85EBCA77);
+    hash = (hash ^ op2) * UINT32_C(0xC2B2AE3D);
+    return hash ^ (hash >> 16);
+}
+
+/* the newest matching entry, a later store to a variable hides the values before it */
+const struct gvn_entry * find(const struct gvn_table * table, enum opcode code, ir_operand_id op1, ir_operand_id op2)
+{
+    uint32_t i = table->buckets[hash_key(code, op1, op2) & table->bucket_mask];
+
+    while (i != GVN_NO_ENTRY) {
+        const struct gvn_entry * entry = &table->entries[i];
+        if (entry->code == code && entry->op1 == op1 && entry->op2 == op2) {
+            return entry;
+        }
+        i = entry->next;
+    }
+
+    return NULL;
+}
+
+void insert(struct gvn_table * table, enum opcode code, ir_operand_id op1, ir_operand_id op2, ir_operand_id value, uint32_t b)
+{
+    uint32_t * bucket = &table->buckets[hash_key(code, op1, op2) & table->bucket_mask];
+    struct gvn_entry * entry = &table->entries[table->entry_count];
+
+    entry->code = code;
+    entry->op1 = op1;
+    entry->op2 = op2;
+    entry->value = value;
+    entry->block = b;
+    entry->next = *bucket;
+    *bucket = table->entry_count++;
+}
+
+/* a phi reads values from the ends of its predecessors, a back edge brings them in after the walk has passed */
+void resolve_phis(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    for (size_t index = function->begin; index < function->end; ++index) {
+        const struct ir_instruction * instruction = ir_program_at(program, index);
+
+        if (instruction->code != OP_PHI) {
+            continue;
+        }
+
+        struct phi * phi = &ir_function_operand(function, instruction->op1)->content.phi;
+        for (uint32_t i = 0; i < phi->count; ++i) {
+            phi->values[i] = optimizer_resolve_alias(ctx, phi->values[i]);
+        }
+    }
+}
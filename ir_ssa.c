@@ -0,0 +1,764 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "optimizer.h"
+#include "ir.h"
+#include "ir_cfg.h"
+#include "symbol.h"
+#include "type.h"
+#include "allocator.h"
+
+#define SSA_NO_PHI (UINT32_MAX)
+
+struct ssa_phi
+{
+    ir_operand_id variable;
+    ir_operand_id operand;
+    ir_operand_id result;
+    uint32_t next; /* next phi of the same block */
+};
+
+struct ssa_undo
+{
+    ir_operand_id variable;
+    ir_operand_id value;
+};
+
+struct ssa_builder
+{
+    struct optimizer_context * ctx;
+    struct ir_program * program;
+    struct ir_function * function;
+    struct ir_cfg cfg;
+    ir_operand_id * current; /* by variable operand ID, the value the variable holds at this point of the walk */
+    uint32_t ** frontiers;
+    uint32_t * frontier_counts;
+    struct ssa_phi * phis;
+    uint32_t phi_count;
+    uint32_t phi_capacity;
+    uint32_t * block_phis; /* first phi of each block */
+    ir_operand_id * block_labels; /* labels added to blocks that have to be named by a phi */
+    bool * dropped; /* by instruction, from the function begin */
+    struct ssa_undo * undo;
+    size_t undo_count;
+    size_t undo_capacity;
+    ir_operand_id undefined; /* zero read by a use that no store reaches */
+};
+
+static bool is_promoted_variable(const struct ir_function * function, ir_operand_id id);
+static void find_variables(struct ssa_builder * builder, bool * globals, uint32_t ** definitions, uint32_t * definition_counts);
+static void compute_dominance_frontiers(struct ssa_builder * builder);
+static void place_phis(struct ssa_builder * builder, const bool * globals, uint32_t * const * definitions, const uint32_t * definition_counts);
+static void add_phi(struct ssa_builder * builder, uint32_t block, ir_operand_id variable);
+static void rename_variables(struct ssa_builder * builder);
+static void rename_block(struct ssa_builder * builder, uint32_t block);
+static void set_current(struct ssa_builder * builder, ir_operand_id variable, ir_operand_id value);
+static ir_operand_id current_value(struct ssa_builder * builder, ir_operand_id variable);
+static ir_operand_id block_tag(struct ssa_builder * builder, uint32_t block);
+static void rebuild_function(struct ssa_builder * builder);
+static void compact_frame(struct ir_function * function);
+static ir_operand_id destruct_block_tag(const struct ir_program * program, const struct ir_cfg * cfg, uint32_t block);
+static bool has_phis(const struct ir_program * program, const struct ir_cfg * cfg, uint32_t block);
+static bool is_conditional_jump(enum opcode code);
+static void emit_edge_copies(struct ir_program * program, struct ir_function * function, const struct ir_cfg * cfg, uint32_t from, uint32_t to, ir_operand_id * destinations, ir_operand_id * sources);
+
+/*
+ * Promotes every named local and parameter to SSA values: loads become the
+ * value last stored on the dominating path, stores disappear and phis merge
+ * the values where paths join (Cytron et al. with semi-pruned placement,
+ * only variables read before being written in some block get phis).
+ */
+void ir_ssa_construct_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    optimizer_prepare_function(ctx, function);
+
+    struct ssa_builder builder;
+    memset(&builder, 0, sizeof(struct ssa_builder));
+    builder.ctx = ctx;
+    builder.program = program;
+    builder.function = function;
+
+    ir_cfg_build(&builder.cfg, program, function, ctx->scratch);
+
+    uint32_t operand_count = ctx->operand_count;
+    uint32_t block_count = builder.cfg.block_count;
+    size_t instruction_count = function->end - function->begin;
+
+    builder.current = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(ir_operand_id) * operand_count, MEMORY_TAG_IR_OPERANDS);
+    builder.block_phis = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    builder.block_labels = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(ir_operand_id) * block_count, MEMORY_TAG_CFG);
+    builder.dropped = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(bool) * instruction_count, MEMORY_TAG_IR_INSTRUCTIONS);
+    memset(builder.current, 0, sizeof(ir_operand_id) * operand_count);
+    memset(builder.block_phis, 0xFF, sizeof(uint32_t) * block_count);
+    memset(builder.block_labels, 0, sizeof(ir_operand_id) * block_count);
+    memset(builder.dropped, 0, sizeof(bool) * instruction_count);
+
+    bool * globals = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(bool) * operand_count, MEMORY_TAG_IR_OPERANDS);
+    uint32_t ** definitions = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(uint32_t *) * operand_count, MEMORY_TAG_IR_OPERANDS);
+    uint32_t * definition_counts = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(uint32_t) * operand_count, MEMORY_TAG_IR_OPERANDS);
+
+    find_variables(&builder, globals, definitions, definition_counts);
+    compute_dominance_frontiers(&builder);
+    place_phis(&builder, globals, definitions, definition_counts);
+    rename_variables(&builder);
+    rebuild_function(&builder);
+    compact_frame(function);
+}
+
+bool is_promoted_variable(const struct ir_function * function, ir_operand_id id)
+{
+    const struct ir_operand * operand = ir_function_operand(function, id);
+    return operand != NULL && operand->kind == OPERAND_KIND_VARIABLE && operand->content.variable.symbol != NULL;
+}
+
+/* a variable is global when some block reads it before writing it, only those can need a phi */
+void find_variables(struct ssa_builder * builder, bool * globals, uint32_t ** definitions, uint32_t * definition_counts)
+{
+    const struct ir_cfg * cfg = &builder->cfg;
+    uint32_t operand_count = builder->ctx->operand_count;
+    uint32_t * marks = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t) * operand_count, MEMORY_TAG_IR_OPERANDS);
+
+    memset(globals, 0, sizeof(bool) * operand_count);
+    memset(definition_counts, 0, sizeof(uint32_t) * operand_count);
+
+    /* the first pass counts the blocks writing every variable, the second one lists them */
+    for (int pass = 0; pass < 2; ++pass) {
+        memset(marks, 0xFF, sizeof(uint32_t) * operand_count);
+
+        for (uint32_t i = 0; i < cfg->reachable_count; ++i) {
+            uint32_t b = cfg->reverse_postorder[i];
+            const struct ir_basic_block * block = &cfg->blocks[b];
+
+            for (size_t index = block->begin; index < block->end; ++index) {
+                const struct ir_instruction * instruction = ir_program_at(builder->program, index);
+
+                if (!is_promoted_variable(builder->function, instruction->op1)) {
+                    continue;
+                }
+
+                ir_operand_id variable = instruction->op1;
+
+                if (instruction->code == OP_LOAD) {
+                    if (marks[variable] != b) {
+                        globals[variable] = true;
+                    }
+                    continue;
+                }
+
+                assert(instruction->code == OP_STORE || instruction->code == OP_STORE_PARAM);
+
+                if (marks[variable] == b) {
+                    continue;
+                }
+                marks[variable] = b;
+
+                if (pass == 0) {
+                    ++definition_counts[variable];
+                } else {
+                    definitions[variable][definition_counts[variable]++] = b;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (ir_operand_id variable = 1; variable < operand_count; ++variable) {
+                if (definition_counts[variable] > 0) {
+                    definitions[variable] = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t) * definition_counts[variable], MEMORY_TAG_CFG);
+                    definition_counts[variable] = 0;
+                }
+            }
+        }
+    }
+}
+
+/* Cooper, Harvey and Kennedy: walk up from every predecessor of a join to its immediate dominator */
+void compute_dominance_frontiers(struct ssa_builder * builder)
+{
+    const struct ir_cfg * cfg = &builder->cfg;
+    uint32_t block_count = cfg->block_count;
+
+    builder->frontiers = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t *) * block_count, MEMORY_TAG_CFG);
+    builder->frontier_counts = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    uint32_t * marks = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+
+    memset(builder->frontier_counts, 0, sizeof(uint32_t) * block_count);
+
+    /* same walk twice, counting and then filling, a block enters a frontier once per join */
+    for (int pass = 0; pass < 2; ++pass) {
+        memset(marks, 0xFF, sizeof(uint32_t) * block_count);
+
+        for (uint32_t b = 0; b < block_count; ++b) {
+            const struct ir_basic_block * block = &cfg->blocks[b];
+
+            if (!ir_cfg_is_reachable(cfg, b) || block->predecessor_count < 2) {
+                continue;
+            }
+
+            for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+                uint32_t runner = block->predecessors[p];
+
+                if (!ir_cfg_is_reachable(cfg, runner)) {
+                    continue;
+                }
+
+                while (runner != block->immediate_dominator && marks[runner] != b) {
+                    marks[runner] = b;
+                    if (pass == 0) {
+                        ++builder->frontier_counts[runner];
+                    } else {
+                        builder->frontiers[runner][builder->frontier_counts[runner]++] = b;
+                    }
+                    runner = cfg->blocks[runner].immediate_dominator;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (uint32_t b = 0; b < block_count; ++b) {
+                builder->frontiers[b] = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t) * (builder->frontier_counts[b] + 1), MEMORY_TAG_CFG);
+                builder->frontier_counts[b] = 0;
+            }
+        }
+    }
+}
+
+/* phis go on the iterated dominance frontier of the blocks writing the variable */
+void place_phis(struct ssa_builder * builder, const bool * globals, uint32_t * const * definitions, const uint32_t * definition_counts)
+{
+    uint32_t block_count = builder->cfg.block_count;
+    uint32_t * worklist = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    ir_operand_id * has_phi = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(ir_operand_id) * block_count, MEMORY_TAG_CFG);
+    ir_operand_id * queued = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(ir_operand_id) * block_count, MEMORY_TAG_CFG);
+
+    memset(has_phi, 0, sizeof(ir_operand_id) * block_count);
+    memset(queued, 0, sizeof(ir_operand_id) * block_count);
+
+    for (ir_operand_id variable = 1; variable < builder->ctx->operand_count; ++variable) {
+        if (!globals[variable]) {
+            continue;
+        }
+
+        uint32_t count = 0;
+
+        for (uint32_t i = 0; i < definition_counts[variable]; ++i) {
+            uint32_t b = definitions[variable][i];
+            queued[b] = variable;
+            worklist[count++] = b;
+        }
+
+        while (count > 0) {
+            uint32_t b = worklist[--count];
+
+            for (uint32_t i = 0; i < builder->frontier_counts[b]; ++i) {
+                uint32_t frontier = builder->frontiers[b][i];
+
+                if (has_phi[frontier] == variable) {
+                    continue;
+                }
+                has_phi[frontier] = variable;
+                add_phi(builder, frontier, variable);
+
+                if (queued[frontier] != variable) {
+                    queued[frontier] = variable;
+                    worklist[count++] = frontier;
+                }
+            }
+        }
+    }
+}
+
+void add_phi(struct ssa_builder * builder, uint32_t block, ir_operand_id variable)
+{
+    if (builder->phi_count == builder->phi_capacity) {
+        uint32_t capacity = builder->phi_capacity > 0 ? builder->phi_capacity * 2 : builder->cfg.block_count;
+        struct ssa_phi * phis = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(struct ssa_phi) * capacity, MEMORY_TAG_IR_OPERANDS);
+        if (builder->phi_count > 0) {
+            memcpy(phis, builder->phis, sizeof(struct ssa_phi) * builder->phi_count);
+        }
+        builder->phis = phis;
+        builder->phi_capacity = capacity;
+    }
+
+    struct ir_function * function = builder->function;
+    struct memory_blob_pool * pool = builder->ctx->pool;
+    struct type * type = ir_function_operand(function, variable)->type;
+    uint32_t predecessor_count = builder->cfg.blocks[block].predecessor_count;
+
+    ir_operand_id id = ir_function_add_operand(function, pool, OPERAND_KIND_PHI);
+    struct ir_operand * operand = ir_function_operand(function, id);
+    operand->type = type;
+    operand->content.phi.values = memory_blob_pool_alloc_tagged(pool, sizeof(ir_operand_id) * predecessor_count, MEMORY_TAG_IR_OPERANDS);
+    operand->content.phi.predecessors = memory_blob_pool_alloc_tagged(pool, sizeof(ir_operand_id) * predecessor_count, MEMORY_TAG_IR_OPERANDS);
+    operand->content.phi.count = 0;
+
+    struct ssa_phi * phi = &builder->phis[builder->phi_count];
+    phi->variable = variable;
+    phi->operand = id;
+    phi->result = ir_function_new_temporary(builder->program, function, type);
+    phi->next = builder->block_phis[block];
+    builder->block_phis[block] = builder->phi_count++;
+}
+
+/* preorder walk of the dominator tree, the undo log restores the values a subtree changed */
+void rename_variables(struct ssa_builder * builder)
+{
+    const struct ir_cfg * cfg = &builder->cfg;
+    uint32_t block_count = cfg->block_count;
+    struct memory_blob_pool * pool = builder->ctx->scratch;
+
+    uint32_t * child_counts = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * (block_count + 1), MEMORY_TAG_CFG);
+    uint32_t * children = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    uint32_t * stack = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+    size_t * undo_marks = memory_blob_pool_alloc_tagged(pool, sizeof(size_t) * block_count, MEMORY_TAG_CFG);
+    uint32_t * next_child = memory_blob_pool_alloc_tagged(pool, sizeof(uint32_t) * block_count, MEMORY_TAG_CFG);
+
+    memset(child_counts, 0, sizeof(uint32_t) * (block_count + 1));
+
+    for (uint32_t b = 0; b < block_count; ++b) {
+        uint32_t dominator = cfg->blocks[b].immediate_dominator;
+        if (dominator != IR_CFG_NO_BLOCK) {
+            ++child_counts[dominator + 1];
+        }
+    }
+    for (uint32_t b = 0; b < block_count; ++b) {
+        child_counts[b + 1] += child_counts[b];
+        next_child[b] = child_counts[b];
+    }
+    for (uint32_t b = 0; b < block_count; ++b) {
+        uint32_t dominator = cfg->blocks[b].immediate_dominator;
+        if (dominator != IR_CFG_NO_BLOCK) {
+            children[next_child[dominator]++] = b;
+        }
+    }
+    for (uint32_t b = 0; b < block_count; ++b) {
+        next_child[b] = child_counts[b];
+    }
+
+    uint32_t depth = 0;
+    stack[depth++] = 0;
+    undo_marks[0] = builder->undo_count;
+    rename_block(builder, 0);
+
+    while (depth > 0) {
+        uint32_t b = stack[depth - 1];
+
+        if (next_child[b] < child_counts[b + 1]) {
+            uint32_t child = children[next_child[b]++];
+            undo_marks[child] = builder->undo_count;
+            rename_block(builder, child);
+            stack[depth++] = child;
+            continue;
+        }
+
+        while (builder->undo_count > undo_marks[b]) {
+            const struct ssa_undo * undo = &builder->undo[--builder->undo_count];
+            builder->current[undo->variable] = undo->value;
+        }
+        --depth;
+    }
+}
+
+void rename_block(struct ssa_builder * builder, uint32_t b)
+{
+    struct optimizer_context * ctx = builder->ctx;
+    const struct ir_basic_block * block = &builder->cfg.blocks[b];
+
+    for (uint32_t p = builder->block_phis[b]; p != SSA_NO_PHI; p = builder->phis[p].next) {
+        set_current(builder, builder->phis[p].variable, builder->phis[p].result);
+    }
+
+    for (size_t index = block->begin; index < block->end; ++index) {
+        struct ir_instruction * instruction = ir_program_at(builder->program, index);
+
+        instruction->op1 = optimizer_resolve_alias(ctx, instruction->op1);
+        instruction->op2 = optimizer_resolve_alias(ctx, instruction->op2);
+
+        if (!is_promoted_variable(builder->function, instruction->op1)) {
+            continue;
+        }
+
+        ir_operand_id variable = instruction->op1;
+
+        switch (instruction->code) {
+            case OP_LOAD:
+                ctx->aliases[instruction->result] = current_value(builder, variable);
+                builder->dropped[index - builder->function->begin] = true;
+                break;
+            case OP_STORE:
+                set_current(builder, variable, instruction->op2);
+                builder->dropped[index - builder->function->begin] = true;
+                break;
+            case OP_STORE_PARAM:
+                instruction->code = OP_PARAM;
+                instruction->op1 = instruction->op2;
+                instruction->op2 = IR_OPERAND_NONE;
+                instruction->result = ir_function_new_temporary(builder->program, builder->function, ir_function_operand(builder->function, variable)->type);
+                set_current(builder, variable, instruction->result);
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (uint32_t s = 0; s < block->successor_count; ++s) {
+        uint32_t successor = block->successors[s];
+
+        for (uint32_t p = builder->block_phis[successor]; p != SSA_NO_PHI; p = builder->phis[p].next) {
+            struct phi * phi = &ir_function_operand(builder->function, builder->phis[p].operand)->content.phi;
+            phi->values[phi->count] = current_value(builder, builder->phis[p].variable);
+            phi->predecessors[phi->count] = block_tag(builder, b);
+            ++phi->count;
+        }
+    }
+}
+
+void set_current(struct ssa_builder * builder, ir_operand_id variable, ir_operand_id value)
+{
+    if (builder->undo_count == builder->undo_capacity) {
+        size_t capacity = builder->undo_capacity > 0 ? builder->undo_capacity * 2 : OPTIMIZER_INITIAL_OPERAND_CAPACITY;
+        struct ssa_undo * undo = memory_blob_pool_alloc_tagged(builder->ctx->scratch, sizeof(struct ssa_undo) * capacity, MEMORY_TAG_IR_OPERANDS);
+        if (builder->undo_count > 0) {
+            memcpy(undo, builder->undo, sizeof(struct ssa_undo) * builder->undo_count);
+        }
+        builder->undo = undo;
+        builder->undo_capacity = capacity;
+    }
+
+    builder->undo[builder->undo_count].variable = variable;
+    builder->undo[builder->undo_count].value = builder->current[variable];
+    ++builder->undo_count;
+
+    builder->current[variable] = value;
+}
+
+ir_operand_id current_value(struct ssa_builder * builder, ir_operand_id variable)
+{
+    if (builder->current[variable] != IR_OPERAND_NONE) {
+        return builder->current[variable];
+    }
+
+    /* reading a variable no store reaches is undefined, zero is as good as anything */
+    if (builder->undefined == IR_OPERAND_NONE) {
+        builder->undefined = ir_function_new_temporary(builder->program, builder->function, ir_function_operand(builder->function, variable)->type);
+    }
+    return builder->undefined;
+}
+
+/* phi arguments name their predecessor by its label, blocks entered by falling through get one */
+ir_operand_id block_tag(struct ssa_builder * builder, uint32_t block)
+{
+    const struct ir_instruction * first = ir_program_at(builder->program, builder->cfg.blocks[block].begin);
+
+    if (block == 0) {
+        return first->result;
+    }
+    if (first->code == OP_LABEL) {
+        return first->op1;
+    }
+    if (builder->block_labels[block] == IR_OPERAND_NONE) {
+        builder->block_labels[block] = ir_function_new_label(builder->program, builder->function);
+    }
+    return builder->block_labels[block];
+}
+
+/* the function is copied to the end of the program without the promoted accesses and unreachable blocks */
+void rebuild_function(struct ssa_builder * builder)
+{
+    struct ir_program * program = builder->program;
+    struct ir_function * function = builder->function;
+    const struct ir_cfg * cfg = &builder->cfg;
+    size_t begin = program->position;
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        const struct ir_basic_block * block = &cfg->blocks[b];
+
+        if (!ir_cfg_is_reachable(cfg, b)) {
+            continue;
+        }
+
+        size_t index = block->begin;
+
+        if (b == 0) {
+            ir_emit(program, ir_program_at(program, index++));
+
+            if (builder->undefined != IR_OPERAND_NONE) {
+                struct ir_instruction instruction = { IR_OPERAND_NONE, IR_OPERAND_NONE, builder->undefined, OP_CONST };
+                struct ir_operand * undefined = ir_function_operand(function, builder->undefined);
+                instruction.op1 = ir_function_constant(function, builder->ctx->pool, 0, undefined->type);
+                ir_emit(program, &instruction);
+            }
+        } else if (ir_program_at(program, index)->code == OP_LABEL) {
+            ir_emit(program, ir_program_at(program, index++));
+        } else if (builder->block_labels[b] != IR_OPERAND_NONE) {
+            struct ir_instruction instruction = { builder->block_labels[b], IR_OPERAND_NONE, IR_OPERAND_NONE, OP_LABEL };
+            ir_emit(program, &instruction);
+        }
+
+        for (uint32_t p = builder->block_phis[b]; p != SSA_NO_PHI; p = builder->phis[p].next) {
+            struct ir_instruction instruction = { builder->phis[p].operand, IR_OPERAND_NONE, builder->phis[p].result, OP_PHI };
+            ir_emit(program, &instruction);
+        }
+
+        for (; index < block->end; ++index) {
+            const struct ir_instruction * instruction = ir_program_at(program, index);
+            if (!builder->dropped[index - function->begin] && instruction->code != OP_FUNC_END) {
+                ir_emit(program, instruction);
+            }
+        }
+    }
+
+    struct ir_instruction function_end = { IR_OPERAND_NONE, IR_OPERAND_NONE, IR_OPERAND_NONE, OP_FUNC_END };
+    ir_emit(program, &function_end);
+
+    function->begin = begin;
+    function->end = program->position;
+}
+
+/* promoted variables no longer live in the frame, only the staged call arguments do */
+void compact_frame(struct ir_function * function)
+{
+    size_t size = 0;
+
+    for (ir_operand_id id = 1; id < function->operands.count; ++id) {
+        struct ir_operand * operand = ir_function_operand(function, id);
+        if (operand->kind == OPERAND_KIND_VARIABLE && operand->content.variable.symbol == NULL) {
+            operand->content.variable.offset = size;
+            size += operand->type->size;
+        }
+    }
+
+    function->local_vars_size = size;
+}
+
+/*
+ * Replaces the phis by copies on the incoming edges. An edge from a block
+ * with two successors gets a block of its own for the copies, inline when it
+ * is the fall-through and at the end of the function when it is the jump.
+ */
+void ir_ssa_destruct_function(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    struct ir_cfg cfg;
+    ir_cfg_build(&cfg, program, function, ctx->scratch);
+
+    uint32_t max_phis = 0;
+    bool any_phis = false;
+
+    for (uint32_t b = 0; b < cfg.block_count; ++b) {
+        uint32_t count = 0;
+        for (size_t index = cfg.blocks[b].begin; index < cfg.blocks[b].end; ++index) {
+            count += ir_program_at(program, index)->code == OP_PHI;
+        }
+        max_phis = count > max_phis ? count : max_phis;
+        any_phis = any_phis || (count > 0 && ir_cfg_is_reachable(&cfg, b));
+    }
+
+    if (!any_phis && cfg.reachable_count == cfg.block_count) {
+        return;
+    }
+
+    ir_operand_id * destinations = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(ir_operand_id) * (max_phis + 1), MEMORY_TAG_IR_OPERANDS);
+    ir_operand_id * sources = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(ir_operand_id) * (max_phis + 1), MEMORY_TAG_IR_OPERANDS);
+    uint32_t * split_from = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(uint32_t) * cfg.block_count, MEMORY_TAG_CFG);
+    ir_operand_id * split_labels = memory_blob_pool_alloc_tagged(ctx->scratch, sizeof(ir_operand_id) * cfg.block_count, MEMORY_TAG_CFG);
+    uint32_t split_count = 0;
+    size_t begin = program->position;
+
+    for (uint32_t b = 0; b < cfg.block_count; ++b) {
+        const struct ir_basic_block * block = &cfg.blocks[b];
+
+        if (!ir_cfg_is_reachable(&cfg, b)) {
+            continue;
+        }
+
+        size_t end = block->end;
+        if (ir_program_at(program, end - 1)->code == OP_FUNC_END) {
+            --end;
+        }
+
+        const struct ir_instruction * last = ir_program_at(program, end - 1);
+
+        if (block->successor_count == 1 && has_phis(program, &cfg, block->successors[0])) {
+            /* the copies have to come before the jump, a conditional one leads to the same block either way */
+            uint32_t successor = block->successors[0];
+            bool ends_with_jump = last->code == OP_JUMP || is_conditional_jump(last->code);
+
+            for (size_t index = block->begin; index < (ends_with_jump ? end - 1 : end); ++index) {
+                if (ir_program_at(program, index)->code != OP_PHI) {
+                    ir_emit(program, ir_program_at(program, index));
+                }
+            }
+
+            emit_edge_copies(program, function, &cfg, b, successor, destinations, sources);
+
+            if (ends_with_jump && successor != b + 1) {
+                struct ir_instruction jump = { destruct_block_tag(program, &cfg, successor), IR_OPERAND_NONE, IR_OPERAND_NONE, OP_JUMP };
+                ir_emit(program, &jump);
+            }
+            continue;
+        }
+
+        struct ir_instruction * jump = NULL;
+
+        for (size_t index = block->begin; index < end; ++index) {
+            if (ir_program_at(program, index)->code != OP_PHI) {
+                jump = ir_emit(program, ir_program_at(program, index));
+            }
+        }
+
+        if (block->successor_count < 2) {
+            continue;
+        }
+
+        assert(jump != NULL && is_conditional_jump(jump->code));
+
+        if (has_phis(program, &cfg, block->successors[0])) {
+            emit_edge_copies(program, function, &cfg, b, block->successors[0], destinations, sources);
+        }
+
+        if (has_phis(program, &cfg, block->successors[1])) {
+            ir_operand_id label = ir_function_new_label(program, function);
+            if (jump->code == OP_JUMP_IF_FALSE) {
+                jump->op2 = label;
+            } else {
+                jump->result = label;
+            }
+            split_from[split_count] = b;
+            split_labels[split_count++] = label;
+        }
+    }
+
+    for (uint32_t i = 0; i < split_count; ++i) {
+        uint32_t from = split_from[i];
+        uint32_t to = cfg.blocks[from].successors[1];
+
+        struct ir_instruction label = { split_labels[i], IR_OPERAND_NONE, IR_OPERAND_NONE, OP_LABEL };
+        ir_emit(program, &label);
+
+        emit_edge_copies(program, function, &cfg, from, to, destinations, sources);
+
+        struct ir_instruction jump = { destruct_block_tag(program, &cfg, to), IR_OPERAND_NONE, IR_OPERAND_NONE, OP_JUMP };
+        ir_emit(program, &jump);
+    }
+
+    struct ir_instruction function_end = { IR_OPERAND_NONE, IR_OPERAND_NONE, IR_OPERAND_NONE, OP_FUNC_END };
+    ir_emit(program, &function_end);
+
+    function->begin = begin;
+    function->end = program->position;
+}
+
+ir_operand_id destruct_block_tag(const struct ir_program * program, const struct ir_cfg * cfg, uint32_t block)
+{
+    const struct ir_instruction * first = ir_program_at(program, cfg->blocks[block].begin);
+
+    if (block == 0) {
+        return first->result;
+    }
+    return first->code == OP_LABEL ? first->op1 : IR_OPERAND_NONE;
+}
+
+bool has_phis(const struct ir_program * program, const struct ir_cfg * cfg, uint32_t block)
+{
+    const struct ir_basic_block * target = &cfg->blocks[block];
+
+    for (size_t index = target->begin; index < target->end; ++index) {
+        enum opcode code = ir_program_at(program, index)->code;
+        if (code == OP_PHI) {
+            return true;
+        }
+        if (code != OP_LABEL) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool is_conditional_jump(enum opcode code)
+{
+    switch (code) {
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_LTE:
+        case OP_JUMP_IF_GTE:
+        case OP_JUMP_IF_UNSIGNED_LTE:
+        case OP_JUMP_IF_UNSIGNED_GTE:
+        case OP_JUMP_IF_NE:
+        case OP_JUMP_IF_EQ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * The phis of a block read their arguments at the same time, so the copies
+ * are ordered to write no destination another copy still has to read, a
+ * cycle is broken by saving one destination to a fresh temporary first.
+ */
+void emit_edge_copies(struct ir_program * program, struct ir_function * function, const struct ir_cfg * cfg, uint32_t from, uint32_t to, ir_operand_id * destinations, ir_operand_id * sources)
+{
+    ir_operand_id tag = destruct_block_tag(program, cfg, from);
+    const struct ir_basic_block * target = &cfg->blocks[to];
+    uint32_t count = 0;
+
+    for (size_t index = target->begin; index < target->end; ++index) {
+        const struct ir_instruction * instruction = ir_program_at(program, index);
+        if (instruction->code != OP_PHI) {
+            continue;
+        }
+
+        const struct phi * phi = &ir_function_operand(function, instruction->op1)->content.phi;
+        uint32_t i = 0;
+        while (i < phi->count && phi->predecessors[i] != tag) {
+            ++i;
+        }
+        assert(i < phi->count);
+
+        if (phi->values[i] != instruction->result) {
+            destinations[count] = instruction->result;
+            sources[count++] = phi->values[i];
+        }
+    }
+
+    while (count > 0) {
+        uint32_t ready = count;
+
+        for (uint32_t i = 0; i < count && ready == count; ++i) {
+            ready = i;
+            for (uint32_t j = 0; j < count; ++j) {
+                if (sources[j] == destinations[i]) {
+                    ready = count;
+                    break;
+                }
+            }
+        }
+
+        if (ready == count) {
+            ir_operand_id saved = ir_function_new_temporary(program, function, ir_function_operand(function, destinations[0])->type);
+            struct ir_instruction save = { destinations[0], IR_OPERAND_NONE, saved, OP_COPY };
+            ir_emit(program, &save);
+            for (uint32_t j = 0; j < count; ++j) {
+                if (sources[j] == destinations[0]) {
+                    sources[j] = saved;
+                }
+            }
+            continue;
+        }
+
+        struct ir_instruction copy = { sources[ready], IR_OPERAND_NONE, destinations[ready], OP_COPY };
+        ir_emit(program, &copy);
+
+        --count;
+        destinations[ready] = destinations[count];
+        sources[ready] = sources[count];
+    }
+}
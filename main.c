@@ -1,8 +1,12 @@
+#include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "cclynx.h"
+#include "hashmap.h"
+#include "allocator.h"
 #include "error.h"
 #include "identifier.h"
 #include "symbol.h"
@@ -12,7 +16,11 @@
 #include "parser.h"
 #include "warning.h"
 #include "ir.h"
+#include "optimizer.h"
+#include "ir_cfg.h"
 #include "target-arm64.h"
+#include "scheduler.h"
+#include "scan.h"
 
 
 enum output_stage {
@@ -20,6 +28,7 @@ enum output_stage {
     STAGE_TOKENS,
     STAGE_AST,
     STAGE_IR,
+    STAGE_CFG,
 };
 
 enum output_format {
@@ -27,69 +36,239 @@ enum output_format {
     FORMAT_DOT,
 };
 
-const char * source_filename = NULL;
+struct input_list
+{
+    const char ** paths;
+    size_t count;
+    size_t capacity;
+};
+
+struct batch_job
+{
+    const char ** input_paths;
+    const char ** output_paths;
+};
+
+struct batch_worker
+{
+    struct cclynx_context ctx;
+    const struct batch_job * job;
+    int exit_code;
+};
+
 enum output_stage output_stage = STAGE_ASM;
 enum output_format output_format = FORMAT_TREE;
 bool output_format_explicit = false;
+bool batch_mode = false;
+bool show_stats = false;
+unsigned int optimization_level = 0;
+unsigned int optimizer_passes = 0;
+bool optimizer_passes_explicit = false;
+unsigned int job_count = 1;
+bool job_count_explicit = false;
+struct input_list arguments;
 struct warning_flags warning_flags;
 
 static void parse_options(int argc, const char * argv[]);
 static void show_usage(const char * program_name, FILE * output);
+static unsigned int parse_job_count(const char * value);
+static unsigned int parse_optimization_level(const char * value);
+static unsigned int parse_optimizer_passes(const char * value);
+static void collect_inputs(struct input_list * inputs, const struct input_list * arguments, struct memory_blob_pool * pool);
+static void add_input(struct input_list * inputs, const char * path);
+static void add_response_file_inputs(struct input_list * inputs, const char * path, struct memory_blob_pool * pool);
+static const char * make_output_path(const char * path, struct memory_blob_pool * pool);
+static void check_output_paths(const struct input_list * inputs, const char ** output_paths, struct memory_blob_pool * pool);
+static int compile_translation_unit(struct cclynx_context * ctx, const char * source_filename, FILE * output);
+static int compile_to_file(struct cclynx_context * ctx, const char * input_path, const char * output_path);
+static int compile_batch(const struct input_list * inputs, struct cclynx_context * driver_ctx);
+static void run_batch_task(void * worker_data, size_t task);
 
 
 int main(const int argc, const char * argv[])
 {
     warning_init_default(&warning_flags);
     parse_options(argc, argv);
+    scan_init();
 
-    if (output_format_explicit && output_stage != STAGE_AST) {
-        cclynx_fatal_error("ERROR: --format is only supported with --emit-ast\n");
+    if (output_format_explicit && output_stage != STAGE_AST && output_stage != STAGE_CFG) {
+        cclynx_fatal_error("ERROR: --format is only supported with --emit-ast and --emit-cfg\n");
     }
 
-    for (int i = 1; i < argc; ++i) {
-        if (strncmp(argv[i], "--", sizeof("--") - 1) == 0 || strncmp(argv[i], "-W", sizeof("-W") - 1) == 0) {
-            continue;
-        }
+    if (batch_mode && output_stage != STAGE_ASM) {
+        cclynx_fatal_error("ERROR: --batch is only supported with --emit-asm\n");
+    }
 
-        source_filename = argv[i];
-        break;
+    if (job_count_explicit && !batch_mode) {
+        cclynx_fatal_error("ERROR: -j is only supported with --batch\n");
     }
 
-    if (source_filename == NULL) {
+    struct cclynx_context driver_ctx;
+    cclynx_init(&driver_ctx);
+
+    struct input_list inputs;
+    memset(&inputs, 0, sizeof(struct input_list));
+    collect_inputs(&inputs, &arguments, &driver_ctx.pool);
+
+    if (inputs.count == 0) {
         cclynx_fatal_error("No source given!\n");
     }
 
-    struct cclynx_context ctx;
-    cclynx_init(&ctx);
+    int exit_code = 0;
+
+    if (!batch_mode) {
+        struct cclynx_context ctx;
+        cclynx_init(&ctx);
+        cclynx_reset(&ctx);
+        exit_code = compile_translation_unit(&ctx, inputs.paths[0], stdout);
+        if (show_stats) {
+            struct memory_blob_pool_stats stats;
+            memset(&stats, 0, sizeof(struct memory_blob_pool_stats));
+            memory_blob_pool_stats_merge(&stats, &ctx.pool.stats);
+            memory_blob_pool_stats_merge(&stats, &ctx.scratch.stats);
+            print_memory_stats(&stats, stderr);
+            if (optimization_level > 0) {
+                print_optimizer_stats(&ctx.optimizer_stats, stderr);
+            }
+        }
+        cclynx_free(&ctx);
+    } else {
+        exit_code = compile_batch(&inputs, &driver_ctx);
+    }
+
+    cclynx_free(&driver_ctx);
+    free(inputs.paths);
+    free(arguments.paths);
+
+    return exit_code;
+}
+
+int compile_batch(const struct input_list * inputs, struct cclynx_context * driver_ctx)
+{
+    assert(inputs != NULL);
+    assert(driver_ctx != NULL);
+
+    struct batch_job job;
+    job.input_paths = inputs->paths;
+    job.output_paths = memory_blob_pool_alloc(&driver_ctx->pool, sizeof(const char *) * inputs->count);
+
+    for (size_t i = 0; i < inputs->count; ++i) {
+        job.output_paths[i] = make_output_path(inputs->paths[i], &driver_ctx->pool);
+    }
+
+    check_output_paths(inputs, job.output_paths, &driver_ctx->pool);
+
+    unsigned int worker_count = job_count > 0 ? job_count : scheduler_default_worker_count();
+    if (worker_count > inputs->count) {
+        worker_count = (unsigned int) inputs->count;
+    }
+
+    struct batch_worker * workers = calloc(worker_count, sizeof(struct batch_worker));
+    void ** worker_data = calloc(worker_count, sizeof(void *));
+
+    if (workers == NULL || worker_data == NULL) {
+        cclynx_fatal_error("ERROR: failed to allocate batch workers\n");
+    }
+
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        cclynx_init(&workers[i].ctx);
+        workers[i].job = &job;
+        workers[i].exit_code = 0;
+        worker_data[i] = &workers[i];
+    }
+
+    scheduler_run(worker_count, inputs->count, run_batch_task, worker_data);
+
+    int exit_code = 0;
+    struct memory_blob_pool_stats stats;
+    memset(&stats, 0, sizeof(struct memory_blob_pool_stats));
+    struct optimizer_stats optimizer_stats;
+    memset(&optimizer_stats, 0, sizeof(struct optimizer_stats));
+
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        if (workers[i].exit_code != 0) {
+            exit_code = workers[i].exit_code;
+        }
+        memory_blob_pool_stats_merge(&stats, &workers[i].ctx.pool.stats);
+        memory_blob_pool_stats_merge(&stats, &workers[i].ctx.scratch.stats);
+        optimizer_stats_merge(&optimizer_stats, &workers[i].ctx.optimizer_stats);
+        cclynx_free(&workers[i].ctx);
+    }
+
+    if (show_stats) {
+        print_memory_stats(&stats, stderr);
+        if (optimization_level > 0) {
+            print_optimizer_stats(&optimizer_stats, stderr);
+        }
+    }
+
+    free(worker_data);
+    free(workers);
+
+    return exit_code;
+}
+
+void run_batch_task(void * worker_data, size_t task)
+{
+    struct batch_worker * worker = worker_data;
+    assert(worker != NULL);
+
+    cclynx_reset(&worker->ctx);
+
+    if (compile_to_file(&worker->ctx, worker->job->input_paths[task], worker->job->output_paths[task]) != 0) {
+        worker->exit_code = 1;
+    }
+}
+
+int compile_translation_unit(struct cclynx_context * ctx, const char * source_filename, FILE * output)
+{
+    assert(ctx != NULL);
+    assert(source_filename != NULL);
+    assert(output != NULL);
 
     struct source source;
-    source_load(&source, source_filename);
+    const char * load_error = source_load(&source, source_filename);
+
+    if (load_error != NULL) {
+        fprintf(stderr, "%s: %s", source_filename, load_error);
+        return 1;
+    }
 
-    init_keywords(&ctx.identifier_table, &ctx.pool);
     struct tokenizer_context tokenizer_ctx;
-    tokenizer_init(&tokenizer_ctx, &ctx.identifier_table, &ctx.pool);
-    init_symbols(&ctx.identifier_table, &ctx.pool);
+    tokenizer_init(&tokenizer_ctx, &ctx->identifier_table, &ctx->pool);
+    init_symbols(&ctx->identifier_table, &ctx->pool);
 
-    struct token * tokens = tokenizer_tokenize_file(&tokenizer_ctx, &source);
+    struct token_stream stream;
+    token_stream_init(&stream, &tokenizer_ctx, &source);
 
     int exit_code = 0;
 
-    struct parser_context parser_ctx;
-    parser_init_context(&parser_ctx, tokens, &ctx.pool, &ctx.global_scope, source_filename);
-    parser_ctx.warning_flags = warning_flags;
-
     if (output_stage == STAGE_TOKENS) {
-        struct token * it = tokens;
-        while (it != &eos_token) {
-            print_token(it, stdout);
-            it = it->next;
+        struct token * token;
+        do {
+            token = token_stream_next(&stream);
+            print_token(token, &source, output);
+        } while (token != &eos_token);
+        if (stream.error != NULL) {
+            fprintf(stderr, "%s: %s", source_filename, stream.error);
+            exit_code = 1;
         }
-        print_token(&eos_token, stdout);
         goto cleanup;
     }
 
+    struct parser_context parser_ctx;
+    parser_init_context(&parser_ctx, &stream, &ctx->pool, &ctx->global_scope, source_filename);
+    parser_ctx.warning_flags = warning_flags;
+
     struct ast_node * ast = parser_parse(&parser_ctx);
 
+    /* the parser saw the end of the stream where the lexer gave up, its complaints about that are noise */
+    if (stream.error != NULL) {
+        fprintf(stderr, "%s: %s", source_filename, stream.error);
+        exit_code = 1;
+        goto cleanup;
+    }
+
     if (parser_ctx.errors.count > 0) {
         error_list_print(&parser_ctx.errors);
     }
@@ -101,18 +280,19 @@ int main(const int argc, const char * argv[])
 
     if (output_stage == STAGE_AST) {
         if (output_format == FORMAT_DOT) {
-            print_ast_dot(ast, stdout);
+            print_ast_dot(ast, output);
         } else {
-            print_ast(ast, stdout);
+            print_ast(ast, output);
         }
         goto cleanup;
     }
 
     struct ir_context ir_ctx;
-    ir_context_init(&ir_ctx, &ctx.pool);
+    ir_context_init(&ir_ctx, &ctx->pool);
+    ir_ctx.skip_unreachable = optimization_level > 0;
 
     struct ir_program ir_program;
-    ir_program_init(&ir_program, &ctx.pool);
+    ir_program_init(&ir_program, &ctx->pool);
 
     {
         struct ast_node_list * iterator = ast->content.translation_unit.list;
@@ -122,22 +302,228 @@ int main(const int argc, const char * argv[])
         }
     }
 
+    if (ir_ctx.error != NULL) {
+        fprintf(stderr, "%s: %s", source_filename, ir_ctx.error);
+        exit_code = 1;
+        goto cleanup;
+    }
+
+    struct optimizer_context optimizer_ctx;
+    optimizer_init(&optimizer_ctx, &ctx->pool, &ctx->scratch, optimization_level);
+    if (optimizer_passes_explicit) {
+        optimizer_ctx.passes = optimizer_passes;
+    }
+    optimizer_run(&optimizer_ctx, &ir_program);
+    optimizer_stats_merge(&ctx->optimizer_stats, &optimizer_ctx.stats);
+
+    const struct ir_function * exhausted_function = ir_program_exhausted_function(&ir_program);
+
+    if (exhausted_function != NULL) {
+        fprintf(stderr, "%s: ERROR: too many operands in function '%s'\n", source_filename, exhausted_function->name->name);
+        exit_code = 1;
+        goto cleanup;
+    }
+
     if (output_stage == STAGE_IR) {
-        print_ir_program(&ir_program, stdout);
+        print_ir_program(&ir_program, output);
         goto cleanup;
     }
 
+    if (output_stage == STAGE_CFG) {
+        struct ir_cfg * cfgs = memory_blob_pool_alloc_tagged(&ctx->pool, sizeof(struct ir_cfg) * ir_program.function_count, MEMORY_TAG_CFG);
+        for (size_t i = 0; i < ir_program.function_count; ++i) {
+            ir_cfg_build(&cfgs[i], &ir_program, ir_program.functions[i], &ctx->pool);
+        }
+        if (output_format == FORMAT_DOT) {
+            print_ir_cfg_dot(&ir_program, cfgs, ir_program.function_count, output);
+        } else {
+            print_ir_cfg(&ir_program, cfgs, ir_program.function_count, output);
+        }
+        goto cleanup;
+    }
+
+    optimizer_leave_ssa(&optimizer_ctx, &ir_program);
+
     struct codegen_context codegen_ctx;
-    codegen_context_init(&codegen_ctx);
-    target_arm64_generate(&codegen_ctx, &ir_program, stdout);
+    codegen_context_init(&codegen_ctx, &ctx->pool);
+    target_arm64_generate(&codegen_ctx, &ir_program, output);
 
 cleanup:
     source_free(&source);
-    cclynx_free(&ctx);
 
     return exit_code;
 }
 
+/* the output is written under a temporary name and only takes the real one once the unit compiled */
+int compile_to_file(struct cclynx_context * ctx, const char * input_path, const char * output_path)
+{
+    assert(ctx != NULL);
+    assert(input_path != NULL);
+    assert(output_path != NULL);
+
+    size_t len = strlen(output_path);
+    char * temporary_path = malloc(len + sizeof(".tmp"));
+
+    if (temporary_path == NULL) {
+        fprintf(stderr, "%s: ERROR: failed to allocate output path\n", output_path);
+        return 1;
+    }
+
+    memcpy(temporary_path, output_path, len);
+    memcpy(temporary_path + len, ".tmp", sizeof(".tmp"));
+
+    int exit_code = 0;
+    FILE * output = fopen(temporary_path, "w");
+
+    if (output == NULL) {
+        fprintf(stderr, "%s: ERROR: cannot open file for writing\n", temporary_path);
+        exit_code = 1;
+    } else {
+        exit_code = compile_translation_unit(ctx, input_path, output);
+
+        if (fclose(output) != 0 && exit_code == 0) {
+            fprintf(stderr, "%s: ERROR: cannot write file\n", temporary_path);
+            exit_code = 1;
+        }
+    }
+
+    if (exit_code == 0 && rename(temporary_path, output_path) != 0) {
+        fprintf(stderr, "%s: ERROR: cannot write file\n", output_path);
+        exit_code = 1;
+    }
+
+    /* an output left from an earlier run would pass for the result of this one */
+    if (exit_code != 0) {
+        remove(temporary_path);
+        remove(output_path);
+    }
+
+    free(temporary_path);
+
+    return exit_code;
+}
+
+void collect_inputs(struct input_list * inputs, const struct input_list * arguments, struct memory_blob_pool * pool)
+{
+    assert(inputs != NULL);
+    assert(arguments != NULL);
+    assert(pool != NULL);
+
+    for (size_t i = 0; i < arguments->count; ++i) {
+        const char * arg = arguments->paths[i];
+
+        if (!batch_mode) {
+            if (inputs->count > 0) {
+                cclynx_fatal_error("ERROR: multiple inputs require --batch\n");
+            }
+            add_input(inputs, arg);
+            continue;
+        }
+
+        if (arg[0] == '@') {
+            add_response_file_inputs(inputs, arg + 1, pool);
+            continue;
+        }
+
+        add_input(inputs, arg);
+    }
+}
+
+void add_input(struct input_list * inputs, const char * path)
+{
+    assert(inputs != NULL);
+    assert(path != NULL);
+
+    if (inputs->count >= inputs->capacity) {
+        inputs->capacity = inputs->capacity == 0 ? 16 : inputs->capacity * 2;
+        const char ** new_paths = realloc(inputs->paths, sizeof(const char *) * inputs->capacity);
+        if (new_paths == NULL) {
+            cclynx_fatal_error("ERROR: failed to allocate input list\n");
+        }
+        inputs->paths = new_paths;
+    }
+
+    inputs->paths[inputs->count++] = path;
+}
+
+void add_response_file_inputs(struct input_list * inputs, const char * path, struct memory_blob_pool * pool)
+{
+    assert(inputs != NULL);
+    assert(path != NULL);
+    assert(pool != NULL);
+
+    struct source response_file;
+    const char * load_error = source_load(&response_file, path);
+
+    if (load_error != NULL) {
+        cclynx_fatal_error("%s: %s", path, load_error);
+    }
+
+    const char * it = response_file.content;
+    const char * end = response_file.content + response_file.size;
+
+    while (it < end) {
+        const char * line_end = memchr(it, '\n', (size_t)(end - it));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+
+        size_t len = (size_t)(line_end - it);
+        if (len > 0 && it[len - 1] == '\r') {
+            --len;
+        }
+
+        if (len > 0) {
+            char * input_path = memory_blob_pool_alloc(pool, len + 1);
+            memcpy(input_path, it, len);
+            input_path[len] = '\0';
+            add_input(inputs, input_path);
+        }
+
+        it = line_end + 1;
+    }
+
+    source_free(&response_file);
+}
+
+const char * make_output_path(const char * path, struct memory_blob_pool * pool)
+{
+    assert(path != NULL);
+    assert(pool != NULL);
+
+    size_t len = strlen(path);
+    if (len > 2 && strcmp(path + len - 2, ".c") == 0) {
+        len -= 2;
+    }
+
+    char * output_path = memory_blob_pool_alloc(pool, len + sizeof(".s"));
+    memcpy(output_path, path, len);
+    memcpy(output_path + len, ".s", sizeof(".s"));
+
+    return output_path;
+}
+
+/* a.c and a both become a.s, two units must not write the same file */
+void check_output_paths(const struct input_list * inputs, const char ** output_paths, struct memory_blob_pool * pool)
+{
+    assert(inputs != NULL);
+    assert(output_paths != NULL);
+    assert(pool != NULL);
+
+    struct hashmap seen;
+    hashmap_init(&seen, inputs->count, pool);
+
+    for (size_t i = 0; i < inputs->count; ++i) {
+        const char * other_input = hashmap_find(&seen, output_paths[i], strlen(output_paths[i]));
+
+        if (other_input != NULL) {
+            cclynx_fatal_error("ERROR: '%s' and '%s' would both be compiled to '%s'\n", other_input, inputs->paths[i], output_paths[i]);
+        }
+
+        hashmap_insert(&seen, output_paths[i], (void *) inputs->paths[i]);
+    }
+}
+
 
 void parse_options(const int argc, const char * argv[])
 {
@@ -171,11 +557,26 @@ void parse_options(const int argc, const char * argv[])
             continue;
         }
 
+        if (strcmp(arg, "--emit-cfg") == 0) {
+            output_stage = STAGE_CFG;
+            continue;
+        }
+
         if (strcmp(arg, "--emit-asm") == 0) {
             output_stage = STAGE_ASM;
             continue;
         }
 
+        if (strcmp(arg, "--batch") == 0) {
+            batch_mode = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--stats") == 0) {
+            show_stats = true;
+            continue;
+        }
+
         if (strcmp(arg, "--no-warnings") == 0) {
             warning_disable_all(&warning_flags);
             continue;
@@ -207,6 +608,32 @@ void parse_options(const int argc, const char * argv[])
             continue;
         }
 
+        if (strcmp(arg, "-j") == 0) {
+            if (i + 1 >= argc) {
+                cclynx_fatal_error("ERROR: missing job count after -j\n");
+            }
+            job_count = parse_job_count(argv[++i]);
+            job_count_explicit = true;
+            continue;
+        }
+
+        if (strncmp(arg, "-j", sizeof("-j") - 1) == 0) {
+            job_count = parse_job_count(arg + sizeof("-j") - 1);
+            job_count_explicit = true;
+            continue;
+        }
+
+        if (strncmp(arg, "--passes=", sizeof("--passes=") - 1) == 0) {
+            optimizer_passes = parse_optimizer_passes(arg + sizeof("--passes=") - 1);
+            optimizer_passes_explicit = true;
+            continue;
+        }
+
+        if (strncmp(arg, "-O", sizeof("-O") - 1) == 0) {
+            optimization_level = parse_optimization_level(arg + sizeof("-O") - 1);
+            continue;
+        }
+
         if (strncmp(arg, "--", sizeof("--") - 1) == 0) {
             cclynx_fatal_error("ERROR: unknown option \"%s\"\n", arg);
         }
@@ -214,19 +641,84 @@ void parse_options(const int argc, const char * argv[])
         if (strncmp(arg, "-W", sizeof("-W") - 1) == 0) {
             cclynx_fatal_error("ERROR: unknown warning option \"%s\"\n", arg);
         }
+
+        add_input(&arguments, arg);
+    }
+}
+
+unsigned int parse_job_count(const char * value)
+{
+    assert(value != NULL);
+
+    char * end = NULL;
+    unsigned long count = strtoul(value, &end, 10);
+
+    if (*value == '\0' || *end != '\0' || count > 1024) {
+        cclynx_fatal_error("ERROR: invalid job count \"%s\"\n", value);
+    }
+
+    /* -j 0 uses every online core */
+    return (unsigned int) count;
+}
+
+unsigned int parse_optimization_level(const char * value)
+{
+    assert(value != NULL);
+
+    char * end = NULL;
+    unsigned long level = strtoul(value, &end, 10);
+
+    if (*value < '0' || *value > '9' || *end != '\0' || level > OPTIMIZATION_LEVEL_MAX) {
+        cclynx_fatal_error("ERROR: unsupported optimization level \"-O%s\"\n", value);
     }
+
+    return (unsigned int) level;
+}
+
+/* a comma separated list of pass names, empty runs none */
+unsigned int parse_optimizer_passes(const char * value)
+{
+    assert(value != NULL);
+
+    unsigned int passes = 0;
+    const char * it = value;
+
+    while (*it != '\0') {
+        const char * comma = strchr(it, ',');
+        size_t len = comma != NULL ? (size_t)(comma - it) : strlen(it);
+        unsigned int pass = optimizer_pass_by_name(it, len);
+
+        if (pass == 0) {
+            cclynx_fatal_error("ERROR: unknown optimizer pass \"%.*s\"\n", (int) len, it);
+        }
+
+        passes |= pass;
+        it += len;
+        if (*it == ',') {
+            ++it;
+        }
+    }
+
+    return passes;
 }
 
 void show_usage(const char * program_name, FILE * output)
 {
-    fprintf(output, "Usage: %s [options] path\n\n\n", program_name);
+    fprintf(output, "Usage: %s [options] path\n", program_name);
+    fprintf(output, "       %s --batch [options] path... [@response-file]\n\n\n", program_name);
     fprintf(output, "OPTIONS\n");
     fprintf(output, "\t--help\n\t    Show this message.\n\n");
     fprintf(output, "\t--emit-tokens\n\t    Produces tokens.\n\n");
     fprintf(output, "\t--emit-ast\n\t    Produces abstract syntax tree.\n\n");
-    fprintf(output, "\t--format=tree|dot\n\t    Output format (default: tree).\n\n");
+    fprintf(output, "\t--format=tree|dot\n\t    Output format of --emit-ast and --emit-cfg (default: tree).\n\n");
     fprintf(output, "\t--emit-ir\n\t    Produces intermediate representation.\n\n");
+    fprintf(output, "\t--emit-cfg\n\t    Produces the control-flow graph of every function with dominators and loop depth.\n\n");
     fprintf(output, "\t--emit-asm\n\t    Produces assembly (default).\n\n");
+    fprintf(output, "\t--batch\n\t    Compile every given path (and every line of @response-file) into its own .s file.\n\n");
+    fprintf(output, "\t-j N\n\t    Compile up to N batch inputs in parallel (0 uses every core).\n\n");
+    fprintf(output, "\t-O0, -O1, -O2\n\t    Optimization level (default: -O0). -O1 folds constants, simplifies arithmetic identities,\n\t    reuses values already computed and removes dead code,\n\t    -O2 also keeps local variables in registers through SSA form.\n\n");
+    fprintf(output, "\t--passes=fold,gvn,dce,ssa,out-of-ssa\n\t    Run only the listed optimizer passes, whatever the level, to test them one at a time.\n\n");
+    fprintf(output, "\t--stats\n\t    Report arena memory usage by phase, and the code the optimizer removed at -O1 and above, on stderr.\n\n");
     fprintf(output, "\t--no-warnings\n\t    Suppress all warning messages.\n\n");
     fprintf(output, "\t-Wall\n\t    Enable all warnings.\n\n");
     fprintf(output, "\t-Wno-<name>\n\t    Disable a specific warning or category.\n\n");
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <string.h>
+
+#include "optimizer.h"
+#include "allocator.h"
+
+typedef void (*optimizer_pass_fn)(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function);
+
+static void run_pass(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function, optimizer_pass_fn pass);
+
+static const struct
+{
+    const char * name;
+    unsigned int pass;
+} optimizer_passes[] = {
+    {"fold", OPTIMIZER_PASS_FOLD},
+    {"gvn", OPTIMIZER_PASS_GVN},
+    {"dce", OPTIMIZER_PASS_DCE},
+    {"ssa", OPTIMIZER_PASS_SSA},
+    {"out-of-ssa", OPTIMIZER_PASS_OUT_OF_SSA},
+};
+
+void optimizer_init(struct optimizer_context * ctx, struct memory_blob_pool * pool, struct memory_blob_pool * scratch, unsigned int level)
+{
+    assert(ctx != NULL);
+    assert(pool != NULL);
+    assert(scratch != NULL);
+    assert(pool != scratch);
+    assert(level <= OPTIMIZATION_LEVEL_MAX);
+    memset(ctx, 0, sizeof(struct optimizer_context));
+    ctx->pool = pool;
+    ctx->scratch = scratch;
+    ctx->level = level;
+    if (level >= 1) {
+        ctx->passes |= OPTIMIZER_PASS_FOLD | OPTIMIZER_PASS_GVN | OPTIMIZER_PASS_DCE;
+    }
+    if (level >= 2) {
+        ctx->passes |= OPTIMIZER_PASS_SSA;
+    }
+}
+
+void optimizer_run(struct optimizer_context * ctx, struct ir_program * program)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+
+    for (size_t f = 0; f < program->function_count; ++f) {
+        /* the driver reports a function that ran out of operands, there is nothing to gain from it */
+        if (program->functions[f]->operands.exhausted) {
+            continue;
+        }
+
+        if (ctx->passes & OPTIMIZER_PASS_SSA) {
+            run_pass(ctx, program, program->functions[f], ir_ssa_construct_function);
+        }
+        if (ctx->passes & OPTIMIZER_PASS_FOLD) {
+            run_pass(ctx, program, program->functions[f], ir_fold_function);
+        }
+        if (ctx->passes & OPTIMIZER_PASS_GVN) {
+            /* a load that reads the value stored before it can hand a constant to an instruction fold has passed */
+            size_t redundant = ctx->stats.redundant_instructions;
+            run_pass(ctx, program, program->functions[f], ir_gvn_function);
+            if ((ctx->passes & OPTIMIZER_PASS_FOLD) && ctx->stats.redundant_instructions != redundant) {
+                run_pass(ctx, program, program->functions[f], ir_fold_function);
+            }
+        }
+        if (ctx->passes & OPTIMIZER_PASS_DCE) {
+            run_pass(ctx, program, program->functions[f], ir_dce_function);
+        }
+        /* lets --emit-ir show the copies and split edges that replace the phis */
+        if (ctx->passes & OPTIMIZER_PASS_OUT_OF_SSA) {
+            run_pass(ctx, program, program->functions[f], ir_ssa_destruct_function);
+        }
+    }
+}
+
+/* the tables a pass builds for one function are dropped before the next pass, so the scratch pool stays as large as one function */
+void run_pass(struct optimizer_context * ctx, struct ir_program * program, struct ir_function * function, optimizer_pass_fn pass)
+{
+    struct memory_blob_pool_mark mark = memory_blob_pool_mark(ctx->scratch);
+    pass(ctx, program, function);
+    memory_blob_pool_rewind(ctx->scratch, mark);
+}
+
+/* 0 for a name that is not a pass */
+unsigned int optimizer_pass_by_name(const char * name, size_t len)
+{
+    assert(name != NULL);
+
+    for (size_t i = 0; i < sizeof(optimizer_passes) / sizeof(optimizer_passes[0]); ++i) {
+        if (strlen(optimizer_passes[i].name) == len && memcmp(optimizer_passes[i].name, name, len) == 0) {
+            return optimizer_passes[i].pass;
+        }
+    }
+
+    return 0;
+}
+
+/* the code generator knows nothing about phis, so SSA form has to be left before it runs */
+void optimizer_leave_ssa(struct optimizer_context * ctx, struct ir_program * program)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+
+    if (!(ctx->passes & OPTIMIZER_PASS_SSA) || (ctx->passes & OPTIMIZER_PASS_OUT_OF_SSA)) {
+        return;
+    }
+
+    for (size_t f = 0; f < program->function_count; ++f) {
+        if (program->functions[f]->operands.exhausted) {
+            continue;
+        }
+        run_pass(ctx, program, program->functions[f], ir_ssa_destruct_function);
+    }
+}
+
+void optimizer_prepare_function(struct optimizer_context * ctx, const struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(function != NULL);
+
+    uint32_t operand_count = function->operands.count > 0 ? function->operands.count : 1;
+
+    if (operand_count > ctx->operand_capacity) {
+        uint32_t capacity = ctx->operand_capacity > 0 ? ctx->operand_capacity : OPTIMIZER_INITIAL_OPERAND_CAPACITY;
+        while (capacity < operand_count) {
+            capacity *= 2;
+        }
+        ctx->aliases = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(ir_operand_id) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->constants = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(ir_operand_id) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->use_counts = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(uint32_t) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->definitions = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(uint32_t) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->operand_capacity = capacity;
+    }
+
+    memset(ctx->aliases, 0, sizeof(ir_operand_id) * operand_count);
+    memset(ctx->constants, 0, sizeof(ir_operand_id) * operand_count);
+    memset(ctx->use_counts, 0, sizeof(uint32_t) * operand_count);
+    memset(ctx->definitions, 0xFF, sizeof(uint32_t) * operand_count);
+    ctx->operand_count = operand_count;
+}
+
+void optimizer_stats_merge(struct optimizer_stats * target, const struct optimizer_stats * source)
+{
+    assert(target != NULL);
+    assert(source != NULL);
+
+    target->redundant_instructions += source->redundant_instructions;
+    target->dead_instructions += source->dead_instructions;
+    target->unreachable_blocks += source->unreachable_blocks;
+    target->nops += source->nops;
+    target->branches += source->branches;
+}
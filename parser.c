@@ -15,6 +15,7 @@
 #include "symbol.h"
 #include "type.h"
 #include "error.h"
+#include "source.h"
 
 
 struct declaration_specifiers
@@ -38,13 +39,27 @@ static struct ast_node * parse_declaration(struct parser_context * ctx);
 static struct ast_node * parse_postfix_expression(struct parser_context * ctx);
 static struct ast_node * parse_primary_expression(struct parser_context * ctx);
 
-static void parse_function_parameter_list(struct parser_context * ctx, struct ast_node ** parameters, unsigned int * parameter_count);
+static void parse_function_parameter_list(struct parser_context * ctx, struct ast_node_buffer * parameters);
 static struct ast_node * parse_number(struct parser_context * ctx, const struct token * token);
 void parse_declaration_specifiers(struct parser_context * ctx, struct declaration_specifiers * specifiers);
 struct type * resolve_type(struct declaration_specifiers * specifiers);
 
 
-static void parser_report_error(struct parser_context * ctx, const struct token * token, const char * fmt, ...)
+static struct source_position parser_resolve_position(struct parser_context * ctx, uint32_t offset)
+{
+    return source_resolve_position(ctx->stream->source, offset);
+}
+
+static struct source_position parser_token_position(struct parser_context * ctx, const struct token * token)
+{
+    if (token == &eos_token) {
+        struct source_position none = {0, 0};
+        return none;
+    }
+    return parser_resolve_position(ctx, token->span.offset);
+}
+
+void parser_report_error(struct parser_context * ctx, const struct token * token, const char * fmt, ...)
 {
     assert(ctx != NULL);
     assert(token != NULL);
@@ -58,14 +73,16 @@ static void parser_report_error(struct parser_context * ctx, const struct token
     vsnprintf(message, sizeof(message), fmt, args);
     va_end(args);
 
+    struct source_position position = parser_token_position(ctx, token);
+
     error_list_add(&ctx->errors, "%s:%u:%u: ERROR: %s\n",
         ctx->source_filename,
-        token->span.position.line,
-        token->span.position.column,
+        position.line,
+        position.column,
         message);
 }
 
-static void parser_report_warning_v(struct parser_context * ctx, enum warning_code code, struct source_position position, const char * fmt, va_list args)
+static void parser_report_warning_v(struct parser_context * ctx, enum warning_code code, const struct token * token, uint32_t offset, const char * fmt, va_list args)
 {
     assert(ctx != NULL);
     assert(fmt != NULL);
@@ -74,6 +91,10 @@ static void parser_report_warning_v(struct parser_context * ctx, enum warning_co
         return;
     }
 
+    struct source_position position = token != NULL
+        ? parser_token_position(ctx, token)
+        : parser_resolve_position(ctx, offset);
+
     char message[512];
     vsnprintf(message, sizeof(message), fmt, args);
 
@@ -92,18 +113,18 @@ void parser_report_warning(struct parser_context * ctx, enum warning_code code,
 
     va_list args;
     va_start(args, fmt);
-    parser_report_warning_v(ctx, code, token->span.position, fmt, args);
+    parser_report_warning_v(ctx, code, token, 0, fmt, args);
     va_end(args);
 }
 
-static void parser_report_warning_at(struct parser_context * ctx, enum warning_code code, struct source_position position, const char * fmt, ...)
+static void parser_report_warning_at(struct parser_context * ctx, enum warning_code code, uint32_t offset, const char * fmt, ...)
 {
     assert(ctx != NULL);
     assert(fmt != NULL);
 
     va_list args;
     va_start(args, fmt);
-    parser_report_warning_v(ctx, code, position, fmt, args);
+    parser_report_warning_v(ctx, code, NULL, offset, fmt, args);
     va_end(args);
 }
 
@@ -148,7 +169,7 @@ static void report_unused_variables(struct parser_context * ctx)
             bool is_parameter = (it->symbol->flags & SYMBOL_FLAG_FUNCTION_PARAMETER) != 0;
             enum warning_code code = is_parameter ? WARNING_UNUSED_PARAMETER : WARNING_UNUSED_VARIABLE;
             const char * kind = is_parameter ? "parameter" : "variable";
-            parser_report_warning_at(ctx, code, it->symbol->declaration_position, "unused %s '%s'", kind, it->symbol->identifier->name);
+            parser_report_warning_at(ctx, code, it->symbol->declaration_offset, "unused %s '%s'", kind, it->symbol->identifier->name);
         }
         it = it->next;
     }
@@ -175,7 +196,7 @@ struct ast_node * parse_translation_unit(struct parser_context * ctx)
         struct ast_node * function_def = parse_function_definition(ctx);
 
         if (function_def != NULL) {
-            struct ast_node_list * element = memory_blob_pool_alloc(ctx->pool, sizeof(struct ast_node_list));
+            struct ast_node_list * element = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct ast_node_list), MEMORY_TAG_AST);
             element->node = function_def;
             *tail = element;
             tail = &element->next;
@@ -200,15 +221,18 @@ struct ast_node * parse_statement(struct parser_context * ctx)
     struct ast_node * statement = NULL;
 
     if (token_is_keyword(current_token)) {
+        /* kept for warnings reported after the body, long after the stream reused its slot */
+        struct token keyword_token = *current_token;
+
         if (current_token->identifier->keyword_code == KEYWORD_WHILE) {
             parser_get_token(ctx);
-            statement = parse_while_statement(ctx, current_token);
+            statement = parse_while_statement(ctx, &keyword_token);
         } else if (current_token->identifier->keyword_code == KEYWORD_RETURN) {
             parser_get_token(ctx);
             statement = parse_return_statement(ctx);
         } else if (current_token->identifier->keyword_code == KEYWORD_IF) {
             parser_get_token(ctx);
-            statement = parse_if_statement(ctx, current_token);
+            statement = parse_if_statement(ctx, &keyword_token);
         } else {
             statement = parse_declaration(ctx);
         }
@@ -253,16 +277,16 @@ struct ast_node * parse_compound_statement(struct parser_context * ctx)
             parser_get_token(ctx);
             break;
         }
-        struct token * stmt_token = current_token;
+        struct token stmt_token = *current_token;
 
         struct ast_node * statement = parse_statement(ctx);
 
         if (ast_is_empty_compound_statement(statement)) {
-            parser_report_warning(ctx, WARNING_EMPTY_COMPOUND_STATEMENT, stmt_token, "empty compound statement");
+            parser_report_warning(ctx, WARNING_EMPTY_COMPOUND_STATEMENT, &stmt_token, "empty compound statement");
         }
 
         if (statement != NULL) {
-            struct ast_node_list * list = memory_blob_pool_alloc(ctx->pool, sizeof(struct ast_node_list));
+            struct ast_node_list * list = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct ast_node_list), MEMORY_TAG_AST);
             list->node = statement;
             list->next = NULL;
 
@@ -328,11 +352,11 @@ struct ast_node * parse_if_statement(struct parser_context * ctx, struct token *
         && strcmp("else", current_token->identifier->name) == 0
     ) {
         parser_get_token(ctx);
-        struct token * else_token = current_token;
+        struct token else_token = *current_token;
         false_branch = parse_statement(ctx);
 
         if (ast_is_empty_compound_statement(false_branch)) {
-            parser_report_warning(ctx, WARNING_EMPTY_ELSE_BODY, else_token, "empty else body");
+            parser_report_warning(ctx, WARNING_EMPTY_ELSE_BODY, &else_token, "empty else body");
         }
     }
 
@@ -496,7 +520,7 @@ struct ast_node * parse_function_definition(struct parser_context * ctx)
     }
 
     struct token * current_token = parser_get_token(ctx);
-    struct token * name_token = current_token;
+    struct token name_token = *current_token;
 
     if (current_token->kind != TOKEN_KIND_IDENTIFIER) {
         parser_report_error(ctx, current_token, "expected identifier but got %s", token_stringify(current_token));
@@ -532,20 +556,19 @@ struct ast_node * parse_function_definition(struct parser_context * ctx)
         return NULL;
     }
 
-    function_symbol = memory_blob_pool_alloc(ctx->pool, sizeof(struct symbol));
+    function_symbol = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct symbol), MEMORY_TAG_SYMBOLS);
     function_symbol->identifier = identifier;
     function_symbol->type = type;
     function_symbol->kind = SYMBOL_KIND_FUNCTION;
 
-    identifier_attach_symbol(ctx->pool, identifier, function_symbol)
     scope_add_symbol(ctx->current_scope, function_symbol, ctx->pool);
 
     int parameter_presence = PARAMETER_PRESENCE_UNSPECIFIED;
 
     current_token = parser_get_token(ctx);
 
-    struct ast_node * parameters[MAX_AST_FUNCTION_PARAMETER_COUNT] = {0};
-    unsigned int parameter_count = 0;
+    struct ast_node_buffer parameters;
+    ast_node_buffer_init(&parameters);
 
     if (
         token_is_keyword(current_token)
@@ -556,7 +579,7 @@ struct ast_node * parse_function_definition(struct parser_context * ctx)
     } else if (!token_is_punctuator(current_token, ')')) {
         parser_putback_token(current_token, ctx);
         ctx->current_scope = scope_push(ctx->current_scope, ctx->pool);
-        parse_function_parameter_list(ctx, parameters, &parameter_count);
+        parse_function_parameter_list(ctx, &parameters);
         current_token = parser_get_token(ctx);
         parameter_presence = PARAMETER_PRESENCE_SPECIFIED;
     }
@@ -574,11 +597,16 @@ struct ast_node * parse_function_definition(struct parser_context * ctx)
         return NULL;
     }
 
+    unsigned int parameter_count = parameters.count;
+
     function_symbol->parameter_presence = parameter_presence;
     function_symbol->parameter_count = parameter_count;
+    if (parameter_count > 0) {
+        function_symbol->parameters = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct symbol *) * parameter_count, MEMORY_TAG_SYMBOLS);
+    }
     for (unsigned int i = 0; i < parameter_count; i++) {
-        function_symbol->parameters[i] = parameters[i]->content.symbol;
-        parameters[i]->content.symbol->parameter_index = i;
+        function_symbol->parameters[i] = parameters.nodes[i]->content.symbol;
+        parameters.nodes[i]->content.symbol->parameter_index = i;
     }
 
     struct symbol * saved_function = ctx->current_function;
@@ -588,22 +616,22 @@ struct ast_node * parse_function_definition(struct parser_context * ctx)
 
     ctx->current_function = saved_function;
 
-    if (parameter_count > 0) {
+    if (parameter_presence == PARAMETER_PRESENCE_SPECIFIED) {
         report_unused_variables(ctx);
         ctx->current_scope = scope_pop(ctx->current_scope);
     }
 
     if (compound_statement != NULL && ast_is_empty_compound_statement(compound_statement)) {
-        parser_report_warning(ctx, WARNING_EMPTY_FUNCTION_BODY, name_token, "function '%s' has empty body", identifier->name);
+        parser_report_warning(ctx, WARNING_EMPTY_FUNCTION_BODY, &name_token, "function '%s' has empty body", identifier->name);
     } else if (type != &type_void && compound_statement != NULL && !ast_statement_always_returns(compound_statement)) {
-        parser_report_warning(ctx, WARNING_MISSING_RETURN, name_token, "function '%s' missing return statement", identifier->name);
+        parser_report_warning(ctx, WARNING_MISSING_RETURN, &name_token, "function '%s' missing return statement", identifier->name);
     }
 
     struct ast_node * function_definition = ast_create_node(ctx->pool, AST_NODE_KIND_FUNCTION_DEFINITION, type);
     function_definition->content.function_definition.name = identifier;
     function_definition->content.function_definition.body = compound_statement;
     function_definition->content.function_definition.parameter_presence = parameter_presence;
-    memcpy(&function_definition->content.function_definition.parameters, &parameters, sizeof(struct ast_node *) * MAX_AST_FUNCTION_PARAMETER_COUNT);
+    function_definition->content.function_definition.parameters = ast_node_buffer_finish(ctx->pool, &parameters);
     function_definition->content.function_definition.parameter_count = parameter_count;
 
     return function_definition;
@@ -676,14 +704,12 @@ struct ast_node * parse_declaration(struct parser_context * ctx)
         return NULL;
     }
 
-    struct symbol * variable = memory_blob_pool_alloc(ctx->pool, sizeof(struct symbol));
+    struct symbol * variable = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct symbol), MEMORY_TAG_SYMBOLS);
     variable->kind = SYMBOL_KIND_VARIABLE;
     variable->identifier = identifier;
     variable->type = type;
-    variable->declaration_position.line = current_token->span.position.line;
-    variable->declaration_position.column = current_token->span.position.column;
+    variable->declaration_offset = current_token->span.offset;
 
-    identifier_attach_symbol(ctx->pool, identifier, variable)
     scope_add_symbol(ctx->current_scope, variable, ctx->pool);
 
     struct ast_node * declaration = ast_create_node(ctx->pool, AST_NODE_KIND_VARIABLE_DECLARATION, variable->type);
@@ -713,7 +739,7 @@ struct ast_node * parse_assignment_expression(struct parser_context * ctx)
         return lhs;
     }
 
-    struct token * current_token = parser_get_token(ctx);
+    struct token assign_token = *parser_get_token(ctx);
 
     struct ast_node * initializer = parse_equality_expression(ctx);
     if (initializer == NULL) {
@@ -724,7 +750,7 @@ struct ast_node * parse_assignment_expression(struct parser_context * ctx)
         lhs->type->kind == initializer->type->kind
         && type_signedness_differs(lhs->type, initializer->type)
     ) {
-        parser_report_warning(ctx, WARNING_SIGN_CONVERSION, current_token,
+        parser_report_warning(ctx, WARNING_SIGN_CONVERSION, &assign_token,
             "implicit conversion changes signedness from '%s' to '%s', use an explicit cast",
             type_stringify(initializer->type), type_stringify(lhs->type));
         struct ast_node * cast = ast_create_node(ctx->pool, AST_NODE_KIND_CAST_EXPRESSION, lhs->type);
@@ -797,6 +823,11 @@ struct ast_node * parse_postfix_expression(struct parser_context * ctx)
 
         if (token_is_punctuator(next_token, '(')) {
             parser_get_token(ctx);
+
+            /* the arguments can push the name out of the token stream ring */
+            struct token name_token = *current_token;
+            current_token = &name_token;
+
             struct symbol * function_symbol = symbol_lookup(current_token->identifier, SYMBOL_KIND_FUNCTION);
 
             if (function_symbol == NULL) {
@@ -809,24 +840,16 @@ struct ast_node * parse_postfix_expression(struct parser_context * ctx)
                 return NULL;
             }
 
-            struct ast_node * arguments[MAX_AST_FUNCTION_ARGUMENT_COUNT] = {0};
-            unsigned int argument_count = 0;
+            struct ast_node_buffer argument_buffer;
+            ast_node_buffer_init(&argument_buffer);
 
             if (token_is_punctuator(parser_peek_token(ctx), ')')) {
                 parser_get_token(ctx);
             } else {
                 do {
                     struct ast_node * argument = parse_assignment_expression(ctx);
-                    arguments[argument_count++] = argument;
+                    ast_node_buffer_push(ctx->pool, &argument_buffer, argument);
                     next_token = parser_get_token(ctx);
-
-                    if (token_is_punctuator(next_token, ',') && argument_count >= MAX_AST_FUNCTION_ARGUMENT_COUNT) {
-                        parser_report_error(ctx, next_token, "too many arguments, maximum is 3");
-                        while (!token_is_punctuator(next_token, ')') && next_token != &eos_token) {
-                            next_token = parser_get_token(ctx);
-                        }
-                        return NULL;
-                    }
                 } while (token_is_punctuator(next_token, ','));
 
                 if (!token_is_punctuator(next_token, ')')) {
@@ -838,6 +861,9 @@ struct ast_node * parse_postfix_expression(struct parser_context * ctx)
                 }
             }
 
+            struct ast_node ** arguments = ast_node_buffer_finish(ctx->pool, &argument_buffer);
+            unsigned int argument_count = argument_buffer.count;
+
             if (function_symbol->parameter_presence == PARAMETER_PRESENCE_UNSPECIFIED && argument_count > 0) {
                 parser_report_warning(ctx, WARNING_UNSPECIFIED_PARAMETERS, current_token,
                     "function '%s' has unspecified parameters, consider using '%s(void)' or adding parameter types",
@@ -882,7 +908,7 @@ struct ast_node * parse_postfix_expression(struct parser_context * ctx)
             struct ast_node * function_call = ast_create_node(ctx->pool, AST_NODE_KIND_FUNCTION_CALL_EXPRESSION, function_symbol->type);
             function_call->content.function_call.function = function_symbol;
             function_call->content.function_call.argument_count = argument_count;
-            memcpy(&function_call->content.function_call.arguments, &arguments, sizeof(struct ast_node *) * MAX_AST_FUNCTION_ARGUMENT_COUNT);
+            function_call->content.function_call.arguments = arguments;
             return function_call;
         }
 
@@ -901,7 +927,7 @@ struct ast_node * parse_number(struct parser_context * ctx, const struct token *
     assert(token != NULL);
     assert(token->kind == TOKEN_KIND_NUMBER);
 
-    const char * ptr = token->source->content + token->span.offset;
+    const char * ptr = ctx->stream->source->content + token->span.offset;
     int is_unsigned = token->flags & TOKEN_FLAG_IS_UNSIGNED;
 
     long long int value = 0;
@@ -981,10 +1007,7 @@ struct token * parser_get_token(struct parser_context * ctx)
     if (ctx->token_buffer_pos > 0)
         return ctx->token_buffer[--ctx->token_buffer_pos];
 
-    struct token * current_token = ctx->iterator;
-    ctx->iterator = ctx->iterator->next;
-
-    return current_token;
+    return token_stream_next(ctx->stream);
 }
 
 struct token * parser_peek_token(struct parser_context * ctx)
@@ -994,7 +1017,13 @@ struct token * parser_peek_token(struct parser_context * ctx)
     if (ctx->token_buffer_pos > 0)
         return ctx->token_buffer[ctx->token_buffer_pos - 1];
 
-    return ctx->iterator;
+    struct token * token = token_stream_next(ctx->stream);
+
+    if (token != &eos_token) {
+        ctx->token_buffer[ctx->token_buffer_pos++] = token;
+    }
+
+    return token;
 }
 
 void parser_putback_token(struct token * token, struct parser_context * ctx)
@@ -1002,27 +1031,28 @@ void parser_putback_token(struct token * token, struct parser_context * ctx)
     assert(token != NULL);
     assert(ctx != NULL);
 
+    /* reading past the end gives the end again, there is nothing to keep */
     if (token == &eos_token) {
-        cclynx_fatal_error("ERROR: Trying to putback EOS token!\n");
+        return;
     }
 
     if (ctx->token_buffer_pos >= MAX_TOKEN_BUFFER_SIZE) {
-        cclynx_fatal_error("ERROR: Maximum token buffer size reached!\n");
+        parser_report_error(ctx, token, "too many tokens put back at %s", token_stringify(token));
+        return;
     }
 
     ctx->token_buffer[ctx->token_buffer_pos++] = token;
 }
 
-void parser_init_context(struct parser_context * ctx, struct token * tokens, struct memory_blob_pool * pool, struct scope * file_scope, const char * source_filename)
+void parser_init_context(struct parser_context * ctx, struct token_stream * stream, struct memory_blob_pool * pool, struct scope * file_scope, const char * source_filename)
 {
     assert(ctx != NULL);
-    assert(tokens != NULL);
+    assert(stream != NULL);
     assert(pool != NULL);
 
     memset(ctx, 0, sizeof(struct parser_context));
     ctx->pool = pool;
-    ctx->tokens = tokens;
-    ctx->iterator = ctx->tokens;
+    ctx->stream = stream;
     ctx->current_scope = file_scope;
     ctx->source_filename = source_filename;
     error_list_init(&ctx->errors, pool);
@@ -1072,15 +1102,13 @@ struct ast_node * parse_function_parameter(struct parser_context * ctx)
         parser_report_error(ctx, current_token, "parameter '%s' already declared", parameter_identifier->name);
     }
 
-    struct symbol * parameter_symbol = memory_blob_pool_alloc(ctx->pool, sizeof(struct symbol));
+    struct symbol * parameter_symbol = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct symbol), MEMORY_TAG_SYMBOLS);
     parameter_symbol->kind = SYMBOL_KIND_VARIABLE;
     parameter_symbol->flags = SYMBOL_FLAG_FUNCTION_PARAMETER;
     parameter_symbol->type = parameter_type;
     parameter_symbol->identifier = parameter_identifier;
-    parameter_symbol->declaration_position.line = current_token->span.position.line;
-    parameter_symbol->declaration_position.column = current_token->span.position.column;
+    parameter_symbol->declaration_offset = current_token->span.offset;
 
-    identifier_attach_symbol(ctx->pool, parameter_identifier, parameter_symbol)
     scope_add_symbol(ctx->current_scope, parameter_symbol, ctx->pool);
 
     struct ast_node * parameter = ast_create_node(ctx->pool, AST_NODE_KIND_FUNCTION_PARAMETER, parameter_symbol->type);
@@ -1089,11 +1117,10 @@ struct ast_node * parse_function_parameter(struct parser_context * ctx)
     return parameter;
 }
 
-void parse_function_parameter_list(struct parser_context * ctx, struct ast_node ** parameters, unsigned int * parameter_count)
+void parse_function_parameter_list(struct parser_context * ctx, struct ast_node_buffer * parameters)
 {
     assert(ctx != NULL);
     assert(parameters != NULL);
-    assert(parameter_count != NULL);
 
     struct token * token;
 
@@ -1104,17 +1131,8 @@ void parse_function_parameter_list(struct parser_context * ctx, struct ast_node
             return;
         }
 
-        parameters[(*parameter_count)++] = parameter;
+        ast_node_buffer_push(ctx->pool, parameters, parameter);
         token = parser_get_token(ctx);
-
-        if (token_is_punctuator(token, ',') && *parameter_count >= MAX_AST_FUNCTION_PARAMETER_COUNT) {
-            parser_report_error(ctx, token, "too many parameters, maximum is 3");
-            while (!token_is_punctuator(token, ')') && token != &eos_token) {
-                token = parser_get_token(ctx);
-            }
-            parser_putback_token(token, ctx);
-            return;
-        }
     } while (token_is_punctuator(token, ','));
 
     parser_putback_token(token, ctx);
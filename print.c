@@ -10,11 +10,17 @@
 #include "ast.h"
 #include "symbol.h"
 #include "ir.h"
+#include "ir_cfg.h"
+#include "optimizer.h"
 #include "type.h"
 #include "error.h"
+#include "allocator.h"
 
 static void do_print_ast(const struct ast_node * ast, FILE * file, int depth, unsigned int * ancestors_info, const char * node_label);
 static int do_print_ast_dot(const struct ast_node * ast, FILE * file, int next_id);
+static void format_ir_instruction(const struct ir_function * function, const struct ir_instruction * instruction, char * buf, size_t size);
+static void print_cfg_block_list(const uint32_t * blocks, uint32_t count, FILE * file);
+static void print_dot_escaped(const char * text, FILE * file);
 
 static void print_tree_indent(FILE * file, int depth, unsigned int * ancestors_info)
 {
@@ -66,9 +72,10 @@ static void print_type_child(FILE * file, int depth, unsigned int * ancestors_in
     print_type_child_labeled(file, depth, ancestors_info, type, has_next_sibling, "Type");
 }
 
-void print_token(const struct token * token, FILE * file)
+void print_token(const struct token * token, const struct source * source, FILE * file)
 {
     assert(token != NULL);
+    assert(source != NULL);
     assert(file != NULL);
 
     switch (token->kind) {
@@ -85,7 +92,7 @@ void print_token(const struct token * token, FILE * file)
             fprintf(file, "<TOKEN_%s '%s'>\n", token->identifier->keyword_code != KEYWORD_NONE ? "KEYWORD" : "IDENTIFIER", token->identifier->name);
             break;
         case TOKEN_KIND_NUMBER:
-            fprintf(file, "<TOKEN_NUMBER '%.*s'>\n", token->span.length, token->source->content + token->span.offset);
+            fprintf(file, "<TOKEN_NUMBER '%.*s'>\n", token->span.length, source->content + token->span.offset);
             break;
         case TOKEN_KIND_EQUAL_PUNCTUATOR:
             fprintf(file, "<TOKEN_SPECIAL_PUNCTUATOR '=='>\n");
@@ -530,136 +537,339 @@ void print_ir_program(const struct ir_program * program, FILE * file)
     assert(file != NULL);
     assert(program->position > 0);
 
-    static char buf[1024] = {'\0'};
-
-    for (size_t idx = 0; idx < program->position; ++idx) {
-        struct ir_instruction * instruction = program->instructions[idx];
-
-        switch (instruction->code) {
-            case OP_JUMP_IF_EQ:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.label_id);
-                fprintf(file, "OP_JUMP_IF_EQ %s\n", buf);
-                break;
-            case OP_JUMP_IF_NE:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.label_id);
-                fprintf(file, "OP_JUMP_IF_NE %s\n", buf);
-                break;
-            case OP_JUMP_IF_LTE:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.label_id);
-                fprintf(file, "OP_JUMP_IF_LTE %s\n", buf);
-                break;
-            case OP_JUMP_IF_GTE:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.label_id);
-                fprintf(file, "OP_JUMP_IF_GTE %s\n", buf);
-                break;
-            case OP_JUMP_IF_UNSIGNED_LTE:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.label_id);
-                fprintf(file, "OP_JUMP_IF_UNSIGNED_LTE %s\n", buf);
-                break;
-            case OP_JUMP_IF_UNSIGNED_GTE:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.label_id);
-                fprintf(file, "OP_JUMP_IF_UNSIGNED_GTE %s\n", buf);
-                break;
-            case OP_LABEL:
-                snprintf(buf, sizeof(buf), "\".L%llu\"", instruction->op1->content.label_id);
-                fprintf(file, "OP_LABEL %s\n", buf);
-                break;
-            case OP_JUMP:
-                snprintf(buf, sizeof(buf), "\".L%llu\"", instruction->op1->content.label_id);
-                fprintf(file, "OP_JUMP %s\n", buf);
-                break;
-            case OP_JUMP_IF_FALSE:
-                snprintf(buf, sizeof(buf), "t%llu, \".L%llu\"", instruction->op1->content.temp_id, instruction->op2->content.label_id);
-                fprintf(file, "OP_JUMP_IF_FALSE %s\n", buf);
-                break;
-            case OP_LT:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_LT %s\n", buf);
-                break;
-            case OP_GT:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_GT %s\n", buf);
-                break;
-            case OP_UNSIGNED_LT:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_UNSIGNED_LT %s\n", buf);
-                break;
-            case OP_UNSIGNED_GT:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_UNSIGNED_GT %s\n", buf);
-                break;
-            case OP_EQ:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_EQ %s\n", buf);
-                break;
-            case OP_NE:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_NE %s\n", buf);
-                break;
-            case OP_STORE:
-                snprintf(buf, sizeof(buf), "t%llu", instruction->op2->content.temp_id);
-                fprintf(file, "OP_STORE %s, %s\n", instruction->op1->content.variable.symbol->identifier->name, buf);
-                break;
-            case OP_LOAD:
-                snprintf(buf, sizeof(buf), "t%llu", instruction->result->content.temp_id);
-                fprintf(file, "OP_LOAD %s, %s\n", instruction->op1->content.variable.symbol->identifier->name, buf);
-                break;
-            case OP_FUNC:
-                fprintf(file, "OP_FUNC \"%s\"\n", instruction->result->content.function.identifier->name);
-                break;
-            case OP_FUNC_END:
-                fprintf(file, "OP_FUNC_END\n");
-                break;
-            case OP_SUB:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_SUB %s\n", buf);
-                break;
-            case OP_DIV:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_DIV %s\n", buf);
-                break;
-            case OP_UNSIGNED_DIV:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_UNSIGNED_DIV %s\n", buf);
-                break;
-            case OP_CONST:
-                {
-                    snprintf(buf, sizeof(buf), "%lld, t%llu", instruction->op1->content.int_value, instruction->result->content.temp_id);
-                    fprintf(file, "OP_CONST %s\n", buf);
-                }
-                break;
-            case OP_RETURN:
-                if (instruction->op1 != NULL) {
-                    snprintf(buf, sizeof(buf), "t%llu", instruction->op1->content.temp_id);
-                    fprintf(file, "OP_RETURN %s\n", buf);
-                } else {
-                    fprintf(file, "OP_RETURN\n");
-                }
-                break;
-            case OP_ADD:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_ADD %s\n", buf);
-                break;
-            case OP_MUL:
-                snprintf(buf, sizeof(buf), "t%llu, t%llu, t%llu", instruction->op1->content.temp_id, instruction->op2->content.temp_id, instruction->result->content.temp_id);
-                fprintf(file, "OP_MUL %s\n", buf);
-                break;
-            case OP_NOP:
-                fprintf(file, "OP_NOP\n");
-                break;
-            case OP_CALL:
-                fprintf(file, "OP_CALL \"%s\", t%llu\n", instruction->op1->content.function.identifier->name, instruction->result->content.temp_id);
-                break;
-            case OP_ARG:
-                fprintf(file, "OP_ARG t%llu, %lld\n", instruction->op1->content.temp_id, instruction->op2->content.int_value);
-                break;
-            case OP_STORE_PARAM:
-                fprintf(file, "OP_STORE_PARAM \"%s\", %lld\n", instruction->op1->content.variable.symbol->identifier->name, instruction->op2->content.int_value);
-                break;
-            default:
-                cclynx_fatal_error("ERROR(print): Unknown instruction for IR program\n");
+    char buf[1024] = {'\0'};
+
+    for (size_t f = 0; f < program->function_count; ++f) {
+        const struct ir_function * function = program->functions[f];
+
+        for (size_t idx = function->begin; idx < function->end; ++idx) {
+            format_ir_instruction(function, ir_program_at(program, idx), buf, sizeof(buf));
+            fprintf(file, "%s\n", buf);
         }
     }
 
     fflush(file);
 }
+
+void print_ir_cfg(const struct ir_program * program, const struct ir_cfg * cfgs, size_t count, FILE * file)
+{
+    assert(program != NULL);
+    assert(cfgs != NULL);
+    assert(file != NULL);
+
+    char buf[1024] = {'\0'};
+
+    for (size_t f = 0; f < count; ++f) {
+        const struct ir_cfg * cfg = &cfgs[f];
+
+        fprintf(file, "CFG \"%s\"\n", cfg->function->name->name);
+
+        for (uint32_t b = 0; b < cfg->block_count; ++b) {
+            const struct ir_basic_block * block = &cfg->blocks[b];
+
+            fprintf(file, "bb%u: preds ", b);
+            print_cfg_block_list(block->predecessors, block->predecessor_count, file);
+            fprintf(file, "; succs ");
+            print_cfg_block_list(block->successors, block->successor_count, file);
+            fprintf(file, "; idom ");
+            print_cfg_block_list(&block->immediate_dominator, block->immediate_dominator != IR_CFG_NO_BLOCK, file);
+            fprintf(file, "; loop depth %u", block->loop_depth);
+            if (ir_cfg_is_loop_header(cfg, b)) {
+                fprintf(file, "; loop header");
+            }
+            if (!ir_cfg_is_reachable(cfg, b)) {
+                fprintf(file, "; unreachable");
+            }
+            fprintf(file, "\n");
+
+            for (size_t idx = block->begin; idx < block->end; ++idx) {
+                format_ir_instruction(cfg->function, ir_program_at(program, idx), buf, sizeof(buf));
+                fprintf(file, "    %s\n", buf);
+            }
+        }
+    }
+
+    fflush(file);
+}
+
+void print_ir_cfg_dot(const struct ir_program * program, const struct ir_cfg * cfgs, size_t count, FILE * file)
+{
+    assert(program != NULL);
+    assert(cfgs != NULL);
+    assert(file != NULL);
+
+    char buf[1024] = {'\0'};
+
+    fprintf(file, "digraph CFG {\n");
+    fprintf(file, "    node [shape=box, fontname=\"monospace\"];\n");
+
+    for (size_t f = 0; f < count; ++f) {
+        const struct ir_cfg * cfg = &cfgs[f];
+
+        fprintf(file, "    subgraph cluster_%zu {\n", f);
+        fprintf(file, "        label=\"%s\";\n", cfg->function->name->name);
+
+        for (uint32_t b = 0; b < cfg->block_count; ++b) {
+            const struct ir_basic_block * block = &cfg->blocks[b];
+
+            fprintf(file, "        f%zub%u [label=\"bb%u", f, b, b);
+            if (block->immediate_dominator != IR_CFG_NO_BLOCK) {
+                fprintf(file, " (idom bb%u)", block->immediate_dominator);
+            }
+            if (block->loop_depth > 0) {
+                fprintf(file, " (loop depth %u)", block->loop_depth);
+            }
+            fprintf(file, "\\l");
+            for (size_t idx = block->begin; idx < block->end; ++idx) {
+                format_ir_instruction(cfg->function, ir_program_at(program, idx), buf, sizeof(buf));
+                print_dot_escaped(buf, file);
+                fprintf(file, "\\l");
+            }
+            fprintf(file, "\"%s];\n", ir_cfg_is_reachable(cfg, b) ? "" : ", style=dotted");
+        }
+
+        for (uint32_t b = 0; b < cfg->block_count; ++b) {
+            const struct ir_basic_block * block = &cfg->blocks[b];
+            for (uint32_t i = 0; i < block->successor_count; ++i) {
+                uint32_t successor = block->successors[i];
+                /* an edge to a block that dominates its source closes a loop */
+                const char * attributes = ir_cfg_dominates(cfg, successor, b) ? " [label=\"back\", style=dashed]" : "";
+                fprintf(file, "        f%zub%u -> f%zub%u%s;\n", f, b, f, successor, attributes);
+            }
+        }
+
+        fprintf(file, "    }\n");
+    }
+
+    fprintf(file, "}\n");
+
+    fflush(file);
+}
+
+void print_cfg_block_list(const uint32_t * blocks, uint32_t count, FILE * file)
+{
+    if (count == 0) {
+        fprintf(file, "none");
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        fprintf(file, "%sbb%u", i > 0 ? ", " : "", blocks[i]);
+    }
+}
+
+void print_dot_escaped(const char * text, FILE * file)
+{
+    for (const char * c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+}
+
+void format_ir_instruction(const struct ir_function * function, const struct ir_instruction * instruction, char * buf, size_t size)
+{
+    assert(function != NULL);
+    assert(instruction != NULL);
+    assert(buf != NULL);
+
+    char operands[1024] = {'\0'};
+    const struct ir_operand * op1 = ir_function_operand(function, instruction->op1);
+    const struct ir_operand * op2 = ir_function_operand(function, instruction->op2);
+    const struct ir_operand * result = ir_function_operand(function, instruction->result);
+
+    switch (instruction->code) {
+        case OP_JUMP_IF_EQ:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, \".L%llu\"", op1->content.temp_id, op2->content.temp_id, result->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_EQ %s", operands);
+            break;
+        case OP_JUMP_IF_NE:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, \".L%llu\"", op1->content.temp_id, op2->content.temp_id, result->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_NE %s", operands);
+            break;
+        case OP_JUMP_IF_LTE:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, \".L%llu\"", op1->content.temp_id, op2->content.temp_id, result->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_LTE %s", operands);
+            break;
+        case OP_JUMP_IF_GTE:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, \".L%llu\"", op1->content.temp_id, op2->content.temp_id, result->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_GTE %s", operands);
+            break;
+        case OP_JUMP_IF_UNSIGNED_LTE:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, \".L%llu\"", op1->content.temp_id, op2->content.temp_id, result->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_UNSIGNED_LTE %s", operands);
+            break;
+        case OP_JUMP_IF_UNSIGNED_GTE:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, \".L%llu\"", op1->content.temp_id, op2->content.temp_id, result->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_UNSIGNED_GTE %s", operands);
+            break;
+        case OP_LABEL:
+            snprintf(operands, sizeof(operands), "\".L%llu\"", op1->content.label_id);
+            snprintf(buf, size, "OP_LABEL %s", operands);
+            break;
+        case OP_JUMP:
+            snprintf(operands, sizeof(operands), "\".L%llu\"", op1->content.label_id);
+            snprintf(buf, size, "OP_JUMP %s", operands);
+            break;
+        case OP_JUMP_IF_FALSE:
+            snprintf(operands, sizeof(operands), "t%llu, \".L%llu\"", op1->content.temp_id, op2->content.label_id);
+            snprintf(buf, size, "OP_JUMP_IF_FALSE %s", operands);
+            break;
+        case OP_LT:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_LT %s", operands);
+            break;
+        case OP_GT:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_GT %s", operands);
+            break;
+        case OP_UNSIGNED_LT:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_UNSIGNED_LT %s", operands);
+            break;
+        case OP_UNSIGNED_GT:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_UNSIGNED_GT %s", operands);
+            break;
+        case OP_EQ:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_EQ %s", operands);
+            break;
+        case OP_NE:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_NE %s", operands);
+            break;
+        case OP_STORE:
+            snprintf(operands, sizeof(operands), "t%llu", op2->content.temp_id);
+            snprintf(buf, size, "OP_STORE %s, %s", op1->content.variable.symbol->identifier->name, operands);
+            break;
+        case OP_LOAD:
+            snprintf(operands, sizeof(operands), "t%llu", result->content.temp_id);
+            snprintf(buf, size, "OP_LOAD %s, %s", op1->content.variable.symbol->identifier->name, operands);
+            break;
+        case OP_FUNC:
+            snprintf(buf, size, "OP_FUNC \"%s\"", result->content.function.identifier->name);
+            break;
+        case OP_FUNC_END:
+            snprintf(buf, size, "OP_FUNC_END");
+            break;
+        case OP_SUB:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_SUB %s", operands);
+            break;
+        case OP_DIV:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_DIV %s", operands);
+            break;
+        case OP_UNSIGNED_DIV:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_UNSIGNED_DIV %s", operands);
+            break;
+        case OP_CONST:
+            {
+                snprintf(operands, sizeof(operands), "%lld, t%llu", op1->content.int_value, result->content.temp_id);
+                snprintf(buf, size, "OP_CONST %s", operands);
+            }
+            break;
+        case OP_RETURN:
+            if (op1 != NULL) {
+                snprintf(operands, sizeof(operands), "t%llu", op1->content.temp_id);
+                snprintf(buf, size, "OP_RETURN %s", operands);
+            } else {
+                snprintf(buf, size, "OP_RETURN");
+            }
+            break;
+        case OP_ADD:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_ADD %s", operands);
+            break;
+        case OP_MUL:
+            snprintf(operands, sizeof(operands), "t%llu, t%llu, t%llu", op1->content.temp_id, op2->content.temp_id, result->content.temp_id);
+            snprintf(buf, size, "OP_MUL %s", operands);
+            break;
+        case OP_NOP:
+            snprintf(buf, size, "OP_NOP");
+            break;
+        case OP_CALL:
+            snprintf(buf, size, "OP_CALL \"%s\", t%llu", op1->content.function.identifier->name, result->content.temp_id);
+            break;
+        case OP_ARG:
+            if (result != NULL) {
+                snprintf(buf, size, "OP_ARG t%llu, %lld, [sp+%zu]", op1->content.temp_id, op2->content.int_value, result->content.variable.offset);
+            } else {
+                snprintf(buf, size, "OP_ARG t%llu, %lld", op1->content.temp_id, op2->content.int_value);
+            }
+            break;
+        case OP_STORE_PARAM:
+            snprintf(buf, size, "OP_STORE_PARAM \"%s\", %lld", op1->content.variable.symbol->identifier->name, op2->content.int_value);
+            break;
+        case OP_PARAM:
+            snprintf(buf, size, "OP_PARAM %lld, t%llu", op1->content.int_value, result->content.temp_id);
+            break;
+        case OP_COPY:
+            snprintf(buf, size, "OP_COPY t%llu, t%llu", op1->content.temp_id, result->content.temp_id);
+            break;
+        case OP_PHI:
+            {
+                size_t length = 0;
+                for (uint32_t i = 0; i < op1->content.phi.count && length < sizeof(operands); ++i) {
+                    const struct ir_operand * value = ir_function_operand(function, op1->content.phi.values[i]);
+                    const struct ir_operand * predecessor = ir_function_operand(function, op1->content.phi.predecessors[i]);
+                    char tag[256] = {'\0'};
+                    if (predecessor->kind == OPERAND_KIND_LABEL) {
+                        snprintf(tag, sizeof(tag), ".L%llu", predecessor->content.label_id);
+                    } else {
+                        snprintf(tag, sizeof(tag), "%s", predecessor->content.function.identifier->name);
+                    }
+                    length += snprintf(operands + length, sizeof(operands) - length, "[t%llu, \"%s\"], ", value->content.temp_id, tag);
+                }
+                snprintf(buf, size, "OP_PHI %st%llu", operands, result->content.temp_id);
+            }
+            break;
+        default:
+            cclynx_fatal_error("ERROR(print): Unknown instruction for IR program\n");
+    }
+}
+
+void print_memory_stats(const struct memory_blob_pool_stats * stats, FILE * file)
+{
+    assert(stats != NULL);
+    assert(file != NULL);
+
+    size_t total_allocations = 0;
+    size_t total_requested = 0;
+    size_t total_padding = 0;
+
+    fprintf(file, "%-16s %12s %12s %12s\n", "memory", "allocations", "requested", "padding");
+
+    for (size_t i = 0; i < MEMORY_TAG_COUNT; ++i) {
+        fprintf(file, "%-16s %12zu %12zu %12zu\n",
+            memory_tag_name((enum memory_tag) i),
+            stats->allocations[i],
+            stats->requested[i],
+            stats->padding[i]
+        );
+        total_allocations += stats->allocations[i];
+        total_requested += stats->requested[i];
+        total_padding += stats->padding[i];
+    }
+
+    fprintf(file, "%-16s %12zu %12zu %12zu\n", "total", total_allocations, total_requested, total_padding);
+    fprintf(file, "blobs: %zu\n", stats->blob_count);
+    fprintf(file, "peak used: %zu bytes\n", stats->peak_used);
+    fprintf(file, "peak reserved: %zu bytes\n", stats->peak_reserved);
+}
+
+void print_optimizer_stats(const struct optimizer_stats * stats, FILE * file)
+{
+    assert(stats != NULL);
+    assert(file != NULL);
+
+    fprintf(file, "%-16s %12s\n", "optimizer", "eliminated");
+    fprintf(file, "%-16s %12zu\n", "redundant", stats->redundant_instructions);
+    fprintf(file, "%-16s %12zu\n", "dead", stats->dead_instructions);
+    fprintf(file, "%-16s %12zu\n", "blocks", stats->unreachable_blocks);
+    fprintf(file, "%-16s %12zu\n", "nops", stats->nops);
+    fprintf(file, "%-16s %12zu\n", "branches", stats->branches);
+}
@@ -0,0 +1,301 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "regalloc.h"
+#include "ir.h"
+#include "ir_cfg.h"
+#include "allocator.h"
+
+static void prepare_function(struct regalloc_context * ctx, const struct ir_function * function);
+static void add_occurrence(struct regalloc_context * ctx, const struct ir_function * function, ir_operand_id id, size_t index, uint32_t block, uint32_t * global_count);
+static void extend_live_ranges(struct regalloc_context * ctx, const struct ir_program * program, const struct ir_function * function, const struct ir_cfg * cfg, uint32_t global_count);
+static void extend(struct live_interval * interval, size_t index);
+static int compare_intervals(const void * lhs, const void * rhs);
+static void linear_scan(struct regalloc_context * ctx);
+
+void regalloc_init(struct regalloc_context * ctx, struct memory_blob_pool * pool, uint32_t register_count)
+{
+    assert(ctx != NULL);
+    assert(pool != NULL);
+    assert(register_count > 0 && register_count <= 32);
+    memset(ctx, 0, sizeof(struct regalloc_context));
+    ctx->pool = pool;
+    ctx->register_count = register_count;
+}
+
+/*
+ * Linear scan over one interval per temporary (Poletto and Sarkar). Most
+ * temporaries never leave the block computing them, only the ones that do
+ * take part in the liveness analysis that stretches their intervals over the
+ * blocks they pass through, loops included.
+ */
+void regalloc_function(struct regalloc_context * ctx, const struct ir_program * program, const struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    prepare_function(ctx, function);
+
+    struct ir_cfg cfg;
+    ir_cfg_build(&cfg, program, function, ctx->pool);
+
+    uint32_t global_count = 0;
+
+    for (uint32_t b = 0; b < cfg.block_count; ++b) {
+        for (size_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+            const struct ir_instruction * instruction = ir_program_at(program, i);
+            add_occurrence(ctx, function, instruction->op1, i, b, &global_count);
+            add_occurrence(ctx, function, instruction->op2, i, b, &global_count);
+            add_occurrence(ctx, function, instruction->result, i, b, &global_count);
+
+            if (instruction->code == OP_COPY && ctx->intervals[ctx->operand_intervals[instruction->result]].start == i) {
+                ctx->intervals[ctx->operand_intervals[instruction->result]].hint = instruction->op1;
+            }
+        }
+    }
+
+    if (global_count > 0) {
+        extend_live_ranges(ctx, program, function, &cfg, global_count);
+        qsort(ctx->intervals, ctx->interval_count, sizeof(struct live_interval), compare_intervals);
+        for (uint32_t i = 0; i < ctx->interval_count; ++i) {
+            ctx->operand_intervals[ctx->intervals[i].operand] = i;
+        }
+    }
+
+    linear_scan(ctx);
+}
+
+void prepare_function(struct regalloc_context * ctx, const struct ir_function * function)
+{
+    uint32_t operand_count = function->operands.count > 0 ? function->operands.count : 1;
+
+    if (operand_count > ctx->operand_capacity) {
+        uint32_t capacity = ctx->operand_capacity > 0 ? ctx->operand_capacity : REGALLOC_INITIAL_OPERAND_CAPACITY;
+        while (capacity < operand_count) {
+            capacity *= 2;
+        }
+        ctx->intervals = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(struct live_interval) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->operand_intervals = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(uint32_t) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->interval_blocks = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(uint32_t) * capacity, MEMORY_TAG_IR_OPERANDS);
+        ctx->operand_capacity = capacity;
+    }
+
+    memset(ctx->operand_intervals, 0xFF, sizeof(uint32_t) * operand_count);
+    ctx->interval_count = 0;
+    ctx->spill_slot_count = 0;
+}
+
+/* the interval block turns into IR_CFG_NO_BLOCK once the temporary is seen in a second block */
+void add_occurrence(struct regalloc_context * ctx, const struct ir_function * function, ir_operand_id id, size_t index, uint32_t block, uint32_t * global_count)
+{
+    const struct ir_operand * operand = ir_function_operand(function, id);
+
+    if (operand == NULL || operand->kind != OPERAND_KIND_TEMPORARY) {
+        return;
+    }
+
+    uint32_t i = ctx->operand_intervals[id];
+
+    if (i == REGALLOC_NO_INTERVAL) {
+        i = ctx->interval_count++;
+        ctx->operand_intervals[id] = i;
+        ctx->intervals[i].operand = id;
+        ctx->intervals[i].start = index;
+        ctx->intervals[i].end = index;
+        ctx->intervals[i].hint = IR_OPERAND_NONE;
+        ctx->interval_blocks[i] = block;
+        return;
+    }
+
+    ctx->intervals[i].end = index;
+
+    if (ctx->interval_blocks[i] != block && ctx->interval_blocks[i] != IR_CFG_NO_BLOCK) {
+        ctx->interval_blocks[i] = IR_CFG_NO_BLOCK;
+        ++*global_count;
+    }
+}
+
+/* backward liveness over bit sets of the temporaries used in more than one block */
+void extend_live_ranges(struct regalloc_context * ctx, const struct ir_program * program, const struct ir_function * function, const struct ir_cfg * cfg, uint32_t global_count)
+{
+    size_t words = (global_count + 63) / 64;
+    size_t set_size = sizeof(uint64_t) * words * cfg->block_count;
+    uint64_t * uses = memory_blob_pool_alloc_tagged(ctx->pool, set_size, MEMORY_TAG_CFG);
+    uint64_t * definitions = memory_blob_pool_alloc_tagged(ctx->pool, set_size, MEMORY_TAG_CFG);
+    uint64_t * live_in = memory_blob_pool_alloc_tagged(ctx->pool, set_size, MEMORY_TAG_CFG);
+    uint64_t * live_out = memory_blob_pool_alloc_tagged(ctx->pool, set_size, MEMORY_TAG_CFG);
+    uint32_t * globals = memory_blob_pool_alloc_tagged(ctx->pool, sizeof(uint32_t) * global_count, MEMORY_TAG_CFG);
+
+    memset(uses, 0, set_size);
+    memset(definitions, 0, set_size);
+    memset(live_in, 0, set_size);
+    memset(live_out, 0, set_size);
+
+    /* the block scratch is free now, it takes the dense number of every global temporary */
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < ctx->interval_count; ++i) {
+        if (ctx->interval_blocks[i] == IR_CFG_NO_BLOCK) {
+            globals[count] = i;
+            ctx->interval_blocks[i] = count++;
+        } else {
+            ctx->interval_blocks[i] = REGALLOC_NO_INTERVAL;
+        }
+    }
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        uint64_t * block_uses = &uses[b * words];
+        uint64_t * block_definitions = &definitions[b * words];
+
+        for (size_t i = cfg->blocks[b].begin; i < cfg->blocks[b].end; ++i) {
+            const struct ir_instruction * instruction = ir_program_at(program, i);
+            const ir_operand_id operands[3] = { instruction->op1, instruction->op2, instruction->result };
+
+            for (int k = 0; k < 3; ++k) {
+                const struct ir_operand * operand = ir_function_operand(function, operands[k]);
+                if (operand == NULL || operand->kind != OPERAND_KIND_TEMPORARY) {
+                    continue;
+                }
+                uint32_t global = ctx->interval_blocks[ctx->operand_intervals[operands[k]]];
+                if (global == REGALLOC_NO_INTERVAL) {
+                    continue;
+                }
+                uint64_t bit = UINT64_C(1) << (global & 63);
+                if (k == 2) {
+                    block_definitions[global >> 6] |= bit;
+                } else if ((block_definitions[global >> 6] & bit) == 0) {
+                    block_uses[global >> 6] |= bit;
+                }
+            }
+        }
+    }
+
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (uint32_t b = cfg->block_count; b-- > 0;) {
+            const struct ir_basic_block * block = &cfg->blocks[b];
+            uint64_t * out = &live_out[b * words];
+            uint64_t * in = &live_in[b * words];
+
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t value = 0;
+                for (uint32_t s = 0; s < block->successor_count; ++s) {
+                    value |= live_in[block->successors[s] * words + w];
+                }
+                out[w] = value;
+
+                value = uses[b * words + w] | (value & ~definitions[b * words + w]);
+                if (value != in[w]) {
+                    in[w] = value;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (uint32_t b = 0; b < cfg->block_count; ++b) {
+        const struct ir_basic_block * block = &cfg->blocks[b];
+
+        for (uint32_t g = 0; g < global_count; ++g) {
+            uint64_t bit = UINT64_C(1) << (g & 63);
+            struct live_interval * interval = &ctx->intervals[globals[g]];
+            if (live_in[b * words + (g >> 6)] & bit) {
+                extend(interval, block->begin);
+            }
+            if (live_out[b * words + (g >> 6)] & bit) {
+                extend(interval, block->end - 1);
+            }
+        }
+    }
+}
+
+/* an interval live before its first definition no longer starts at the copy its hint came from */
+void extend(struct live_interval * interval, size_t index)
+{
+    if (index < interval->start) {
+        interval->start = index;
+        interval->hint = IR_OPERAND_NONE;
+    }
+    if (index > interval->end) {
+        interval->end = index;
+    }
+}
+
+int compare_intervals(const void * lhs, const void * rhs)
+{
+    const struct live_interval * a = lhs;
+    const struct live_interval * b = rhs;
+
+    if (a->start != b->start) {
+        return a->start < b->start ? -1 : 1;
+    }
+    return a->operand < b->operand ? -1 : a->operand > b->operand;
+}
+
+/*
+ * An interval ending where another starts still holds its register, the
+ * instruction reads it while writing the new one. When no register is left
+ * the interval ending last goes to a spill slot.
+ */
+void linear_scan(struct regalloc_context * ctx)
+{
+    uint32_t active[32];
+    uint32_t active_count = 0;
+    uint32_t free_registers = ctx->register_count == 32 ? UINT32_MAX : (UINT32_C(1) << ctx->register_count) - 1;
+
+    for (uint32_t i = 0; i < ctx->interval_count; ++i) {
+        struct live_interval * current = &ctx->intervals[i];
+
+        for (uint32_t a = 0; a < active_count;) {
+            const struct live_interval * interval = &ctx->intervals[active[a]];
+            if (interval->end < current->start) {
+                free_registers |= UINT32_C(1) << interval->location;
+                active[a] = active[--active_count];
+            } else {
+                ++a;
+            }
+        }
+
+        if (current->hint != IR_OPERAND_NONE) {
+            const struct live_interval * source = regalloc_interval(ctx, current->hint);
+            uint32_t a = 0;
+            while (a < active_count && &ctx->intervals[active[a]] != source) {
+                ++a;
+            }
+            /* the copy is the last read of its source, the register passes straight on */
+            if (a < active_count && source->end == current->start) {
+                current->location = source->location;
+                active[a] = i;
+                continue;
+            }
+        }
+
+        if (free_registers != 0) {
+            current->location = (uint32_t) __builtin_ctz(free_registers);
+            free_registers &= ~(UINT32_C(1) << current->location);
+            active[active_count++] = i;
+            continue;
+        }
+
+        uint32_t furthest = 0;
+        for (uint32_t a = 1; a < active_count; ++a) {
+            if (ctx->intervals[active[a]].end > ctx->intervals[active[furthest]].end) {
+                furthest = a;
+            }
+        }
+
+        struct live_interval * victim = &ctx->intervals[active[furthest]];
+
+        if (victim->end > current->end) {
+            current->location = victim->location;
+            victim->location = ctx->register_count + ctx->spill_slot_count++;
+            active[furthest] = i;
+        } else {
+            current->location = ctx->register_count + ctx->spill_slot_count++;
+        }
+    }
+}
@@ -0,0 +1,273 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#define SCAN_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(SCAN_HAVE_SSE2) && defined(__GNUC__)
+#define SCAN_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define SCAN_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+static const char * skip_whitespace_scalar(const char * p, const char * end)
+{
+    for (; p < end; ++p) {
+        switch (*p) {
+            case ' ':
+            case '\t':
+            case '\v':
+            case '\f':
+            case '\r':
+            case '\n':
+                continue;
+            default:
+                return p;
+        }
+    }
+    return end;
+}
+
+static const char * find_comment_end_scalar(const char * p, const char * end)
+{
+    for (; p < end; ++p) {
+        if (*p == '*' && p + 1 < end && p[1] == '/') {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+#ifdef SCAN_HAVE_SSE2
+
+static const char * skip_whitespace_sse2(const char * p, const char * end)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i control_span = _mm_set1_epi8('\r' - '\t');
+
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        /* '\t'..'\r' are contiguous, so one unsigned range check covers them */
+        __m128i offset = _mm_sub_epi8(block, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, control_span), offset);
+        __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(block, space), control);
+
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(whitespace) & 0xFFFF;
+
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+
+        p += 16;
+    }
+
+    return skip_whitespace_scalar(p, end);
+}
+
+static const char * find_comment_end_sse2(const char * p, const char * end)
+{
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+
+    /* the second load reads one byte ahead, so keep 17 bytes in range */
+    while (end - p >= 17) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        __m128i next = _mm_loadu_si128((const __m128i *)(p + 1));
+
+        uint32_t found = (uint32_t)(_mm_movemask_epi8(_mm_cmpeq_epi8(block, star)) & _mm_movemask_epi8(_mm_cmpeq_epi8(next, slash)));
+
+        if (found != 0) {
+            return p + __builtin_ctz(found);
+        }
+
+        p += 16;
+    }
+
+    return find_comment_end_scalar(p, end);
+}
+
+#endif /* SCAN_HAVE_SSE2 */
+
+#ifdef SCAN_HAVE_AVX2
+
+__attribute__((target("avx2")))
+static const char * skip_whitespace_avx2(const char * p, const char * end)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i control_span = _mm256_set1_epi8('\r' - '\t');
+
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        __m256i offset = _mm256_sub_epi8(block, tab);
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, control_span), offset);
+        __m256i whitespace = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), control);
+
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(whitespace);
+
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+
+        p += 32;
+    }
+
+    return skip_whitespace_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char * find_comment_end_avx2(const char * p, const char * end)
+{
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+
+    while (end - p >= 33) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        __m256i next = _mm256_loadu_si256((const __m256i *)(p + 1));
+
+        uint32_t found = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, star)) & (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(next, slash));
+
+        if (found != 0) {
+            return p + __builtin_ctz(found);
+        }
+
+        p += 32;
+    }
+
+    return find_comment_end_sse2(p, end);
+}
+
+#endif /* SCAN_HAVE_AVX2 */
+
+#ifdef SCAN_HAVE_NEON
+
+/* NEON has no movemask: narrow every byte of the comparison to a nibble */
+static inline uint64_t neon_mask(uint8x16_t compare)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(compare), 4)), 0);
+}
+
+static const char * skip_whitespace_neon(const char * p, const char * end)
+{
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t tab = vdupq_n_u8('\t');
+    const uint8x16_t control_span = vdupq_n_u8('\r' - '\t');
+
+    while (end - p >= 16) {
+        uint8x16_t block = vld1q_u8((const uint8_t *)p);
+        uint8x16_t control = vcleq_u8(vsubq_u8(block, tab), control_span);
+        uint8x16_t whitespace = vorrq_u8(vceqq_u8(block, space), control);
+
+        uint64_t stop = ~neon_mask(whitespace);
+
+        if (stop != 0) {
+            return p + __builtin_ctzll(stop) / 4;
+        }
+
+        p += 16;
+    }
+
+    return skip_whitespace_scalar(p, end);
+}
+
+static const char * find_comment_end_neon(const char * p, const char * end)
+{
+    const uint8x16_t star = vdupq_n_u8('*');
+    const uint8x16_t slash = vdupq_n_u8('/');
+
+    while (end - p >= 17) {
+        uint8x16_t block = vld1q_u8((const uint8_t *)p);
+        uint8x16_t next = vld1q_u8((const uint8_t *)(p + 1));
+
+        uint64_t found = neon_mask(vandq_u8(vceqq_u8(block, star), vceqq_u8(next, slash)));
+
+        if (found != 0) {
+            return p + __builtin_ctzll(found) / 4;
+        }
+
+        p += 16;
+    }
+
+    return find_comment_end_scalar(p, end);
+}
+
+#endif /* SCAN_HAVE_NEON */
+
+
+static const struct scan_implementation implementations[] = {
+#ifdef SCAN_HAVE_AVX2
+    {"avx2", skip_whitespace_avx2, find_comment_end_avx2},
+#endif
+#ifdef SCAN_HAVE_SSE2
+    {"sse2", skip_whitespace_sse2, find_comment_end_sse2},
+#endif
+#ifdef SCAN_HAVE_NEON
+    {"neon", skip_whitespace_neon, find_comment_end_neon},
+#endif
+    {"scalar", skip_whitespace_scalar, find_comment_end_scalar},
+};
+
+#define IMPLEMENTATION_COUNT (sizeof(implementations) / sizeof(implementations[0]))
+
+/* scalar until scan_init() has looked at the CPU */
+static const struct scan_implementation * current = &implementations[IMPLEMENTATION_COUNT - 1];
+
+static bool implementation_supported(const struct scan_implementation * implementation)
+{
+#ifdef SCAN_HAVE_AVX2
+    if (implementation->skip_whitespace == skip_whitespace_avx2) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void)implementation;
+    return true;
+}
+
+/*
+ * Picks the widest scanner the CPU supports. Must run before any worker
+ * thread starts tokenizing.
+ */
+void scan_init(void)
+{
+    for (size_t i = 0; i < IMPLEMENTATION_COUNT; ++i) {
+        if (implementation_supported(&implementations[i])) {
+            current = &implementations[i];
+            return;
+        }
+    }
+}
+
+const struct scan_implementation * scan_available_implementations(size_t * count)
+{
+    assert(count != NULL);
+
+    size_t first = 0;
+    while (!implementation_supported(&implementations[first])) {
+        ++first;
+    }
+
+    *count = IMPLEMENTATION_COUNT - first;
+    return &implementations[first];
+}
+
+const char * scan_skip_whitespace(const char * p, const char * end)
+{
+    return current->skip_whitespace(p, end);
+}
+
+const char * scan_find_comment_end(const char * p, const char * end)
+{
+    return current->find_comment_end(p, end);
+}
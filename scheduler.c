@@ -0,0 +1,178 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+#include "error.h"
+
+/*
+ * Every worker owns a deque of task indices. The owner takes tasks from the
+ * bottom, idle workers steal from the top of somebody else's deque. Tasks are
+ * never created while running, so a worker may stop as soon as all deques
+ * are observed empty.
+ */
+struct work_queue
+{
+    pthread_mutex_t lock;
+    size_t * tasks;
+    size_t top;
+    size_t bottom;
+};
+
+struct worker
+{
+    pthread_t thread;
+    unsigned int index;
+    struct scheduler * scheduler;
+};
+
+struct scheduler
+{
+    struct work_queue * queues;
+    struct worker * workers;
+    unsigned int worker_count;
+    scheduler_task_fn run_task;
+    void ** worker_data;
+};
+
+
+unsigned int scheduler_default_worker_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int) count : 1;
+}
+
+static bool work_queue_pop(struct work_queue * queue, size_t * task)
+{
+    assert(queue != NULL);
+    assert(task != NULL);
+
+    bool found = false;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->top < queue->bottom) {
+        *task = queue->tasks[--queue->bottom];
+        found = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return found;
+}
+
+static bool work_queue_steal(struct work_queue * queue, size_t * task)
+{
+    assert(queue != NULL);
+    assert(task != NULL);
+
+    bool found = false;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->top < queue->bottom) {
+        *task = queue->tasks[queue->top++];
+        found = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return found;
+}
+
+static bool scheduler_next_task(struct scheduler * scheduler, unsigned int worker_index, size_t * task)
+{
+    assert(scheduler != NULL);
+    assert(task != NULL);
+
+    if (work_queue_pop(&scheduler->queues[worker_index], task)) {
+        return true;
+    }
+
+    for (unsigned int i = 1; i < scheduler->worker_count; ++i) {
+        unsigned int victim = (worker_index + i) % scheduler->worker_count;
+        if (work_queue_steal(&scheduler->queues[victim], task)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void * worker_main(void * arg)
+{
+    struct worker * worker = arg;
+    struct scheduler * scheduler = worker->scheduler;
+
+    size_t task;
+    while (scheduler_next_task(scheduler, worker->index, &task)) {
+        scheduler->run_task(scheduler->worker_data[worker->index], task);
+    }
+
+    return NULL;
+}
+
+void scheduler_run(unsigned int worker_count, size_t task_count, scheduler_task_fn run_task, void ** worker_data)
+{
+    assert(worker_count > 0);
+    assert(run_task != NULL);
+    assert(worker_data != NULL);
+
+    struct scheduler scheduler;
+    memset(&scheduler, 0, sizeof(struct scheduler));
+    scheduler.worker_count = worker_count;
+    scheduler.run_task = run_task;
+    scheduler.worker_data = worker_data;
+    scheduler.queues = calloc(worker_count, sizeof(struct work_queue));
+    scheduler.workers = calloc(worker_count, sizeof(struct worker));
+
+    if (scheduler.queues == NULL || scheduler.workers == NULL) {
+        cclynx_fatal_error("ERROR: failed to allocate scheduler\n");
+    }
+
+    /* deal the tasks out in contiguous slices so that each worker starts with its own share */
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        struct work_queue * queue = &scheduler.queues[i];
+        size_t first = task_count * i / worker_count;
+        size_t last = task_count * (i + 1) / worker_count;
+
+        pthread_mutex_init(&queue->lock, NULL);
+        queue->tasks = malloc(sizeof(size_t) * (last - first + 1));
+        if (queue->tasks == NULL) {
+            cclynx_fatal_error("ERROR: failed to allocate scheduler queue\n");
+        }
+
+        /* the owner pops from the bottom, so store the slice reversed to run it in order */
+        for (size_t task = first; task < last; ++task) {
+            queue->tasks[last - 1 - task] = task;
+        }
+        queue->top = 0;
+        queue->bottom = last - first;
+    }
+
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        scheduler.workers[i].index = i;
+        scheduler.workers[i].scheduler = &scheduler;
+    }
+
+    for (unsigned int i = 1; i < worker_count; ++i) {
+        if (pthread_create(&scheduler.workers[i].thread, NULL, worker_main, &scheduler.workers[i]) != 0) {
+            cclynx_fatal_error("ERROR: failed to start worker thread\n");
+        }
+    }
+
+    worker_main(&scheduler.workers[0]);
+
+    for (unsigned int i = 1; i < worker_count; ++i) {
+        pthread_join(scheduler.workers[i].thread, NULL);
+    }
+
+    for (unsigned int i = 0; i < worker_count; ++i) {
+        pthread_mutex_destroy(&scheduler.queues[i].lock);
+        free(scheduler.queues[i].tasks);
+    }
+
+    free(scheduler.queues);
+    free(scheduler.workers);
+}
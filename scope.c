@@ -10,9 +10,10 @@ struct scope * scope_push(struct scope * scope, struct memory_blob_pool * pool)
 {
     assert(scope != NULL);
     assert(pool != NULL);
-    struct scope * new_scope = memory_blob_pool_alloc(pool, sizeof(struct scope));
+    struct scope * new_scope = memory_blob_pool_alloc_tagged(pool, sizeof(struct scope), MEMORY_TAG_SYMBOLS);
     new_scope->enclosing = scope;
     new_scope->symbols = NULL;
+    new_scope->depth = scope->depth + 1;
     return new_scope;
 }
 
@@ -35,9 +36,13 @@ struct scope * scope_pop(const struct scope * scope)
 void scope_add_symbol(struct scope * scope, struct symbol * symbol, struct memory_blob_pool * pool)
 {
     assert(scope != NULL);
+    assert(symbol != NULL);
     assert(pool != NULL);
 
-    struct symbol_list * new_element = memory_blob_pool_alloc(pool, sizeof(struct symbol_list));
+    symbol->scope_depth = scope->depth;
+    identifier_attach_symbol(pool, symbol->identifier, symbol)
+
+    struct symbol_list * new_element = memory_blob_pool_alloc_tagged(pool, sizeof(struct symbol_list), MEMORY_TAG_SYMBOLS);
     new_element->symbol = symbol;
     new_element->next = scope->symbols;
     scope->symbols = new_element;
@@ -46,15 +51,17 @@ void scope_add_symbol(struct scope * scope, struct symbol * symbol, struct memor
 struct symbol * scope_find_symbol(const struct scope * scope, const struct identifier * identifier, enum symbol_kind symbol_kind)
 {
     assert(scope != NULL);
+    assert(identifier != NULL);
 
-    const struct symbol_list * it = scope->symbols;
+    /* inner bindings are gone by now, so the ones of this scope are on top */
+    const struct symbol_list * it = identifier->symbols;
 
-    while (it != NULL) {
-        if (it->symbol->identifier == identifier && it->symbol->kind == symbol_kind)
+    while (it != NULL && it->symbol->scope_depth == scope->depth) {
+        if (it->symbol->kind == symbol_kind)
             return it->symbol;
 
         it = it->next;
     }
 
     return NULL;
-}
\ No newline at end of file
+}
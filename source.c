@@ -1,122 +1,233 @@
+#define _DEFAULT_SOURCE
+
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "source.h"
 #include "error.h"
 
 #define SOURCE_LOAD_CHUNK_SIZE 4096
+#define SOURCE_MAX_SIZE ((size_t)UINT32_MAX) /* token spans and line offsets are 32-bit */
+
+static char * map_file(int fd, size_t size, size_t * mapped_size);
+static char * read_stream(int fd, size_t * size);
 
-void source_load(struct source * source, const char * path)
+/* returns NULL on success, otherwise the message to report for the file */
+const char * source_load(struct source * source, const char * path)
 {
     assert(source != NULL);
     assert(path != NULL);
 
-    FILE * file = fopen(path, "rb");
+    int fd = open(path, O_RDONLY);
 
-    if (file == NULL) {
-        cclynx_fatal_error("ERROR: cannot open file '%s'\n", path);
+    if (fd < 0) {
+        return "ERROR: cannot open file\n";
     }
 
+    struct stat st;
     char * content = NULL;
-    size_t read_size = 0;
+    size_t size = 0;
+    size_t mapped_size = 0;
 
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        if ((uintmax_t)st.st_size > SOURCE_MAX_SIZE) {
+            close(fd);
+            return "ERROR: file is larger than 4 GiB\n";
+        }
+        size = (size_t)st.st_size;
+        content = map_file(fd, size, &mapped_size);
+    }
 
-    if (file_size >= 0) {
-        fseek(file, 0, SEEK_SET);
+    /* pipes, terminals and empty files go through the stream path */
+    if (content == NULL) {
+        content = read_stream(fd, &size);
+    }
 
-        content = malloc(file_size + 1);
+    close(fd);
 
-        if (content == NULL) {
-            fclose(file);
-            cclynx_fatal_error("ERROR: cannot allocate memory for file '%s'\n", path);
-        }
+    if (content == NULL) {
+        return "ERROR: cannot allocate memory for file\n";
+    }
 
-        read_size = fread(content, 1, file_size, file);
-    } else {
-        size_t capacity = SOURCE_LOAD_CHUNK_SIZE;
-        content = malloc(capacity);
+    if (size > SOURCE_MAX_SIZE) {
+        free(content);
+        return "ERROR: file is larger than 4 GiB\n";
+    }
 
-        if (content == NULL) {
-            fclose(file);
-            cclynx_fatal_error("ERROR: cannot allocate memory for file '%s'\n", path);
+    source->content = content;
+    source->path = (char *)path;
+    source->cursor = 0;
+    source->size = size;
+    source->mapped_size = mapped_size;
+    source->line_offsets = NULL;
+    source->line_count = 0;
+
+    return NULL;
+}
+
+/*
+ * Maps the file read-only so the tokens point straight into the page cache.
+ * The tokenizer relies on content[size] == '\0': the kernel zero-fills the
+ * tail of the last page, and when the file ends exactly on a page boundary
+ * an extra anonymous page is reserved right behind it.
+ */
+static char * map_file(int fd, size_t size, size_t * mapped_size)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = (size + page_size - 1) / page_size * page_size;
+    char * content;
+
+    if (size < length) {
+        content = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (content == MAP_FAILED) {
+            return NULL;
+        }
+    } else {
+        length += page_size;
+        content = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (content == MAP_FAILED) {
+            return NULL;
         }
+        if (mmap(content, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(content, length);
+            return NULL;
+        }
+    }
+
+    madvise(content, size, MADV_SEQUENTIAL);
 
-        size_t n;
-        while ((n = fread(content + read_size, 1, capacity - read_size, file)) > 0) {
-            read_size += n;
-            if (read_size == capacity) {
-                capacity *= 2;
-                char * new_content = realloc(content, capacity);
-                if (new_content == NULL) {
-                    free(content);
-                    fclose(file);
-                    cclynx_fatal_error("ERROR: cannot allocate memory for file '%s'\n", path);
-                }
-                content = new_content;
+    *mapped_size = length;
+    return content;
+}
+
+static char * read_stream(int fd, size_t * size)
+{
+    size_t capacity = SOURCE_LOAD_CHUNK_SIZE;
+    size_t read_size = 0;
+    char * content = malloc(capacity);
+
+    if (content == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        if (read_size + 1 >= capacity) {
+            capacity *= 2;
+            char * new_content = realloc(content, capacity);
+            if (new_content == NULL) {
+                free(content);
+                return NULL;
             }
+            content = new_content;
         }
-    }
 
-    fclose(file);
+        ssize_t n = read(fd, content + read_size, capacity - read_size - 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        read_size += (size_t)n;
+        if (read_size > SOURCE_MAX_SIZE) {
+            break;
+        }
+    }
 
     content[read_size] = '\0';
 
-    source->content = content;
-    source->path = (char *)path;
-    source->cursor = 0;
-    source->size = read_size;
-    source->line = 1;
-    source->column = 1;
+    *size = read_size;
+    return content;
 }
 
-int source_get_char(struct source * source)
+static void build_line_offsets(struct source * source)
 {
-    assert(source != NULL);
+    size_t capacity = SOURCE_LOAD_CHUNK_SIZE;
+    uint32_t * offsets = malloc(sizeof(uint32_t) * capacity);
 
-    if (source->cursor >= source->size) {
-        return EOF;
+    if (offsets == NULL) {
+        cclynx_fatal_error("ERROR: cannot allocate line index for file '%s'\n", source->path);
     }
 
-    int ch = (unsigned char)source->content[source->cursor++];
+    uint32_t count = 0;
+    const char * content = source->content;
+    const char * end = content + source->size;
+    const char * line = content;
+
+    for (;;) {
+        if (count == capacity) {
+            capacity *= 2;
+            uint32_t * new_offsets = realloc(offsets, sizeof(uint32_t) * capacity);
+            if (new_offsets == NULL) {
+                free(offsets);
+                cclynx_fatal_error("ERROR: cannot allocate line index for file '%s'\n", source->path);
+            }
+            offsets = new_offsets;
+        }
+
+        offsets[count++] = (uint32_t)(line - content);
 
-    if (ch == '\n') {
-        source->line++;
-        source->previous_column = source->column;
-        source->column = 1;
-    } else {
-        source->column++;
+        const char * newline = memchr(line, '\n', (size_t)(end - line));
+        if (newline == NULL) {
+            break;
+        }
+        line = newline + 1;
     }
 
-    return ch;
+    source->line_offsets = offsets;
+    source->line_count = count;
 }
 
-void source_unget_char(struct source * source, int ch)
+/*
+ * Positions are only needed for diagnostics, so the line index is built
+ * the first time one is asked for and searched from then on.
+ */
+struct source_position source_resolve_position(struct source * source, uint32_t offset)
 {
     assert(source != NULL);
+    assert(offset <= source->size);
 
-    if (ch == EOF) {
-        cclynx_fatal_error("ERROR: cannot unget EOF\n");
+    if (source->line_offsets == NULL) {
+        build_line_offsets(source);
     }
 
-    assert(source->cursor > 0);
-    source->cursor--;
+    uint32_t low = 0;
+    uint32_t high = source->line_count;
 
-    if (ch == '\n') {
-        source->line--;
-        source->column = source->previous_column;
-    } else {
-        source->column--;
+    /* find the last line that starts at or before offset */
+    while (high - low > 1) {
+        uint32_t middle = low + (high - low) / 2;
+        if (source->line_offsets[middle] <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
     }
+
+    struct source_position position;
+    position.line = low + 1;
+    position.column = offset - source->line_offsets[low] + 1;
+    return position;
 }
 
 void source_free(struct source * source)
 {
     assert(source != NULL);
 
-    free(source->content);
+    free(source->line_offsets);
+    source->line_offsets = NULL;
+
+    if (source->mapped_size > 0) {
+        munmap(source->content, source->mapped_size);
+    } else {
+        free(source->content);
+    }
     source->content = NULL;
 }
@@ -8,68 +8,156 @@
 #include "util.h"
 #include "type.h"
 #include "error.h"
+#include "allocator.h"
+#include "regalloc.h"
 
 static const struct codegen_reg initial_regs[CODEGEN_REG_COUNT] = {
-    { "w9",  CODEGEN_REG_KIND_INTEGER,   0, },
-    { "w10", CODEGEN_REG_KIND_INTEGER,   0, },
-    { "w11", CODEGEN_REG_KIND_INTEGER,   0, },
-    { "w12", CODEGEN_REG_KIND_INTEGER,   0, },
-    { "w13", CODEGEN_REG_KIND_INTEGER,   0, },
-    { "w14", CODEGEN_REG_KIND_INTEGER,   0, },
-    { "w15", CODEGEN_REG_KIND_INTEGER,   0, },
+    { "w9",  CODEGEN_REG_KIND_INTEGER, },
+    { "w10", CODEGEN_REG_KIND_INTEGER, },
+    { "w11", CODEGEN_REG_KIND_INTEGER, },
+    { "w12", CODEGEN_REG_KIND_INTEGER, },
+    { "w13", CODEGEN_REG_KIND_INTEGER, },
+    { "w14", CODEGEN_REG_KIND_INTEGER, },
+    { "w15", CODEGEN_REG_KIND_INTEGER, },
 };
 
-static void op_const(struct codegen_context * ctx, FILE * output, struct ir_operand * op1);
-static void op_load(struct codegen_context * ctx, FILE * output, struct ir_operand * op1);
+static void op_const(struct codegen_context * ctx, FILE * output, ir_operand_id result, struct ir_operand * op1);
+static void op_load(struct codegen_context * ctx, FILE * output, ir_operand_id result, struct ir_operand * op1);
+static void prepare_function(struct codegen_context * ctx, const struct ir_program * program, const struct ir_function * function);
+static const char * operand_reg(struct codegen_context * ctx, FILE * output, ir_operand_id id, const char * scratch);
+static const char * define_reg(struct codegen_context * ctx, ir_operand_id id);
+static void finish_definition(struct codegen_context * ctx, FILE * output, ir_operand_id id);
+static void update_live(struct codegen_context * ctx, size_t index);
+static void emit_sp_adjust(FILE * output, const char * op, size_t amount);
+static void emit_sp_access(FILE * output, const char * op, const char * reg, size_t offset);
+static void emit_scratch_address(FILE * output, size_t value);
 
-static void push_reg(struct codegen_context * ctx, struct codegen_reg * reg)
+static const struct live_interval * operand_interval(struct codegen_context * ctx, ir_operand_id id)
 {
     assert(ctx != NULL);
-    assert(reg != NULL);
-    if (ctx->reg_stack_pos >= CODEGEN_REG_STACK_SIZE) {
-        cclynx_fatal_error("ERROR: reg stack overflow for target arm64 generator\n");
+    assert(id != IR_OPERAND_NONE);
+    if (ctx->regalloc.operand_intervals[id] == REGALLOC_NO_INTERVAL) {
+        cclynx_fatal_error("ERROR: use of an undefined temporary in target arm64 generator\n");
     }
-    ctx->reg_stack[ctx->reg_stack_pos++] = reg;
+    return regalloc_interval(&ctx->regalloc, id);
 }
 
-static struct codegen_reg * pop_reg(struct codegen_context * ctx)
+/* spill slots sit above the frame slots of the function */
+static size_t spill_offset(const struct codegen_context * ctx, const struct live_interval * interval)
 {
-    assert(ctx != NULL);
-    if (ctx->reg_stack_pos <= 0) {
-        cclynx_fatal_error("ERROR: reg stack underflow for target arm64 generator\n");
+    return ctx->function->local_vars_size + (interval->location - ctx->regalloc.register_count) * 4;
+}
+
+/* a spilled operand is loaded into the scratch register first */
+const char * operand_reg(struct codegen_context * ctx, FILE * output, ir_operand_id id, const char * scratch)
+{
+    const struct live_interval * interval = operand_interval(ctx, id);
+
+    if (!regalloc_is_spilled(&ctx->regalloc, interval)) {
+        return ctx->regs[interval->location].name;
     }
-    struct codegen_reg * reg = ctx->reg_stack[ctx->reg_stack_pos - 1];
-    ctx->reg_stack[ctx->reg_stack_pos - 1] = NULL;
-    --ctx->reg_stack_pos;
-    return reg;
+
+    emit_sp_access(output, "ldr", scratch, spill_offset(ctx, interval));
+    return scratch;
 }
 
-static struct codegen_reg * alloc_reg(struct codegen_context * ctx, enum codegen_reg_kind kind)
+/* a spilled result is computed in w16 and stored by finish_definition */
+const char * define_reg(struct codegen_context * ctx, ir_operand_id id)
 {
-    assert(ctx != NULL);
-    for (size_t i = 0; i < CODEGEN_REG_COUNT; ++i) {
-        struct codegen_reg * reg = &ctx->regs[i];
-        if (reg->kind == kind && reg->busy == 0) {
-            reg->busy = 1;
-            return reg;
-        }
+    const struct live_interval * interval = operand_interval(ctx, id);
+    return regalloc_is_spilled(&ctx->regalloc, interval) ? "w16" : ctx->regs[interval->location].name;
+}
+
+void finish_definition(struct codegen_context * ctx, FILE * output, ir_operand_id id)
+{
+    const struct live_interval * interval = operand_interval(ctx, id);
+
+    if (regalloc_is_spilled(&ctx->regalloc, interval)) {
+        emit_sp_access(output, "str", "w16", spill_offset(ctx, interval));
+    }
+}
+
+/* ADD and SUB encode a 12-bit immediate, a larger amount is materialized in x17 */
+void emit_sp_adjust(FILE * output, const char * op, size_t amount)
+{
+    if (amount <= 4095) {
+        fprintf(output, "    %s sp, sp, #%zu\n", op, amount);
+        return;
     }
 
-    cclynx_fatal_error("ERROR: too many registers\n");
+    emit_scratch_address(output, amount);
+    fprintf(output, "    %s sp, sp, x17\n", op);
 }
 
-static void free_reg(struct codegen_reg * reg)
+/* a word LDR or STR encodes its offset divided by 4 in 12 bits, a larger one is added from x17 */
+void emit_sp_access(FILE * output, const char * op, const char * reg, size_t offset)
 {
-    assert(reg != NULL);
+    if (offset <= 16380 && offset % 4 == 0) {
+        fprintf(output, "    %s %s, [sp, #%zu]\n", op, reg, offset);
+        return;
+    }
 
-    reg->busy = 0;
+    emit_scratch_address(output, offset);
+    fprintf(output, "    %s %s, [sp, x17]\n", op, reg);
 }
 
-void codegen_context_init(struct codegen_context * ctx)
+/* x17 is never allocated and only holds a second operand until it is read, so it is free whenever an address is needed */
+void emit_scratch_address(FILE * output, size_t value)
+{
+    fprintf(output, "    movz x17, #0x%zx\n", value & 0xFFFF);
+
+    for (unsigned int shift = 16; shift < 64 && (value >> shift) != 0; shift += 16) {
+        size_t chunk = (value >> shift) & 0xFFFF;
+        if (chunk != 0) {
+            fprintf(output, "    movk x17, #0x%zx, lsl #%u\n", chunk, shift);
+        }
+    }
+}
+
+/* the registers live across an instruction, in the order their intervals start, are the ones saved around calls */
+void update_live(struct codegen_context * ctx, size_t index)
+{
+    const struct regalloc_context * regalloc = &ctx->regalloc;
+
+    unsigned int kept = 0;
+    for (unsigned int j = 0; j < ctx->live_count; ++j) {
+        if (ctx->live[j]->end > index) {
+            ctx->live[kept++] = ctx->live[j];
+        }
+    }
+
+    while (ctx->next_interval < regalloc->interval_count && regalloc->intervals[ctx->next_interval].start < index) {
+        const struct live_interval * interval = &regalloc->intervals[ctx->next_interval++];
+        if (!regalloc_is_spilled(regalloc, interval) && interval->end > index) {
+            assert(kept < CODEGEN_REG_COUNT);
+            ctx->live[kept++] = interval;
+        }
+    }
+
+    ctx->live_count = kept;
+}
+
+void codegen_context_init(struct codegen_context * ctx, struct memory_blob_pool * pool)
 {
     assert(ctx != NULL);
+    assert(pool != NULL);
     memset(ctx, 0, sizeof(struct codegen_context));
     memcpy(ctx->regs, initial_regs, sizeof(initial_regs));
+    regalloc_init(&ctx->regalloc, pool, CODEGEN_REG_COUNT);
+}
+
+void prepare_function(struct codegen_context * ctx, const struct ir_program * program, const struct ir_function * function)
+{
+    assert(ctx != NULL);
+    assert(program != NULL);
+    assert(function != NULL);
+
+    regalloc_function(&ctx->regalloc, program, function);
+
+    ctx->function = function;
+    ctx->frame_size = align_up(function->local_vars_size + ctx->regalloc.spill_slot_count * 4, 16);
+    ctx->live_count = 0;
+    ctx->next_interval = 0;
 }
 
 void target_arm64_generate(struct codegen_context * ctx, struct ir_program * program, FILE * file)
@@ -83,264 +171,314 @@ void target_arm64_generate(struct codegen_context * ctx, struct ir_program * pro
     fprintf(file, ".align 2\n");
     fprintf(file, "\n");
 
-    for (size_t i = 0; i < program->position; ++i) {
-        struct ir_instruction * instruction = program->instructions[i];
-
-        switch (instruction->code) {
-            case OP_LABEL:
-                fprintf(file, ".L%llu:\n", instruction->op1->content.label_id);
-                break;
-            case OP_JUMP:
-                fprintf(file, "    b .L%llu\n", instruction->op1->content.label_id);
-                break;
-            case OP_FUNC:
-                fprintf(file, ".global _%s\n", instruction->result->content.function.identifier->name);
-                fprintf(file, "_%s:\n", instruction->result->content.function.identifier->name);
-                fprintf(file, "    stp x29, x30, [sp, -16]!\n");
-                fprintf(file, "    mov x29, sp\n");
-                if (instruction->result->content.function.local_vars_size > 0) {
-                    fprintf(file, "    sub sp, sp, #%zu\n", align_up(instruction->result->content.function.local_vars_size, 16));
-                }
-                break;
-            case OP_FUNC_END:
-                break;
-            case OP_NOP:
-                fprintf(file, "    nop\n");
-                break;
-            case OP_STORE:
-                {
-                    struct codegen_reg * result_reg = pop_reg(ctx);
-                    fprintf(file, "    str %s, [sp, #%zu]\n", result_reg->name, instruction->op1->content.variable.offset);
-                    free_reg(result_reg);
-                }
-                break;
-            case OP_JUMP_IF_FALSE:
-                {
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    fprintf(file, "    cbz %s, .L%llu\n", op1_reg->name, instruction->op2->content.label_id);
-                    free_reg(op1_reg);
-                }
-                break;
-            case OP_JUMP_IF_EQ:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    b.eq .L%llu\n", instruction->result->content.label_id);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                }
-                break;
-            case OP_JUMP_IF_NE:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    b.ne .L%llu\n", instruction->result->content.label_id);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                }
-                break;
-            case OP_JUMP_IF_LTE:
-            case OP_JUMP_IF_UNSIGNED_LTE:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    const char * cond = instruction->code == OP_JUMP_IF_UNSIGNED_LTE ? "b.ls" : "b.le";
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    %s .L%llu\n", cond, instruction->result->content.label_id);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                }
-                break;
-            case OP_JUMP_IF_GTE:
-            case OP_JUMP_IF_UNSIGNED_GTE:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    const char * cond = instruction->code == OP_JUMP_IF_UNSIGNED_GTE ? "b.hs" : "b.ge";
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    %s .L%llu\n", cond, instruction->result->content.label_id);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                }
-                break;
-            case OP_GT:
-            case OP_UNSIGNED_GT:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    const char * cond = instruction->code == OP_UNSIGNED_GT ? "hi" : "gt";
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    cset %s, %s\n", result_reg->name, cond);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_LT:
-            case OP_UNSIGNED_LT:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    const char * cond = instruction->code == OP_UNSIGNED_LT ? "lo" : "lt";
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    cset %s, %s\n", result_reg->name, cond);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_EQ:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    cset %s, eq\n", result_reg->name);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_NE:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    fprintf(file, "    cmp %s, %s\n", op1_reg->name, op2_reg->name);
-                    fprintf(file, "    cset %s, ne\n", result_reg->name);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_LOAD:
-                op_load(ctx, file, instruction->op1);
-                break;
-            case OP_CONST:
-                op_const(ctx, file, instruction->op1);
-                break;
-            case OP_MUL:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    fprintf(file, "    mul %s, %s, %s\n", result_reg->name, op1_reg->name, op2_reg->name);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_DIV:
-            case OP_UNSIGNED_DIV:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    const char * op = instruction->code == OP_UNSIGNED_DIV ? "udiv" : "sdiv";
-                    fprintf(file, "    %s %s, %s, %s\n", op, result_reg->name, op1_reg->name, op2_reg->name);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_SUB:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    fprintf(file, "    sub %s, %s, %s\n", result_reg->name, op1_reg->name, op2_reg->name);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_ADD:
-                {
-                    struct codegen_reg * op2_reg = pop_reg(ctx);
-                    struct codegen_reg * op1_reg = pop_reg(ctx);
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    fprintf(file, "    add %s, %s, %s\n", result_reg->name, op1_reg->name, op2_reg->name);
-                    free_reg(op1_reg);
-                    free_reg(op2_reg);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            case OP_RETURN:
-                {
-                    if (instruction->op1 != NULL) {
-                        struct codegen_reg * result_reg = pop_reg(ctx);
-                        fprintf(file, "    mov w0, %s\n", result_reg->name);
-                        free_reg(result_reg);
+    for (size_t f = 0; f < program->function_count; ++f) {
+        const struct ir_function * function = program->functions[f];
+
+        prepare_function(ctx, program, function);
+
+        for (size_t i = function->begin; i < function->end; ++i) {
+            struct ir_instruction * instruction = ir_program_at(program, i);
+            struct ir_operand * op1 = ir_function_operand(function, instruction->op1);
+            struct ir_operand * op2 = ir_function_operand(function, instruction->op2);
+            struct ir_operand * result = ir_function_operand(function, instruction->result);
+
+            update_live(ctx, i);
+
+            switch (instruction->code) {
+                case OP_LABEL:
+                    fprintf(file, ".L%llu:\n", op1->content.label_id);
+                    break;
+                case OP_JUMP:
+                    fprintf(file, "    b .L%llu\n", op1->content.label_id);
+                    break;
+                case OP_FUNC:
+                    fprintf(file, ".global _%s\n", function->name->name);
+                    fprintf(file, "_%s:\n", function->name->name);
+                    fprintf(file, "    stp x29, x30, [sp, -16]!\n");
+                    fprintf(file, "    mov x29, sp\n");
+                    if (ctx->frame_size > 0) {
+                        emit_sp_adjust(file, "sub", ctx->frame_size);
+                    }
+                    break;
+                case OP_FUNC_END:
+                    break;
+                case OP_NOP:
+                    fprintf(file, "    nop\n");
+                    break;
+                case OP_STORE:
+                    {
+                        const char * value_reg = operand_reg(ctx, file, instruction->op2, "w16");
+                        emit_sp_access(file, "str", value_reg, op1->content.variable.offset);
+                    }
+                    break;
+                case OP_JUMP_IF_FALSE:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        fprintf(file, "    cbz %s, .L%llu\n", op1_reg, op2->content.label_id);
+                    }
+                    break;
+                case OP_JUMP_IF_EQ:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    b.eq .L%llu\n", result->content.label_id);
+                    }
+                    break;
+                case OP_JUMP_IF_NE:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    b.ne .L%llu\n", result->content.label_id);
+                    }
+                    break;
+                case OP_JUMP_IF_LTE:
+                case OP_JUMP_IF_UNSIGNED_LTE:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * cond = instruction->code == OP_JUMP_IF_UNSIGNED_LTE ? "b.ls" : "b.le";
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    %s .L%llu\n", cond, result->content.label_id);
                     }
+                    break;
+                case OP_JUMP_IF_GTE:
+                case OP_JUMP_IF_UNSIGNED_GTE:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * cond = instruction->code == OP_JUMP_IF_UNSIGNED_GTE ? "b.hs" : "b.ge";
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    %s .L%llu\n", cond, result->content.label_id);
+                    }
+                    break;
+                case OP_GT:
+                case OP_UNSIGNED_GT:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        const char * cond = instruction->code == OP_UNSIGNED_GT ? "hi" : "gt";
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    cset %s, %s\n", result_reg, cond);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_LT:
+                case OP_UNSIGNED_LT:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        const char * cond = instruction->code == OP_UNSIGNED_LT ? "lo" : "lt";
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    cset %s, %s\n", result_reg, cond);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_EQ:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    cset %s, eq\n", result_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_NE:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        fprintf(file, "    cmp %s, %s\n", op1_reg, op2_reg);
+                        fprintf(file, "    cset %s, ne\n", result_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_LOAD:
+                    op_load(ctx, file, instruction->result, op1);
+                    finish_definition(ctx, file, instruction->result);
+                    break;
+                case OP_CONST:
+                    op_const(ctx, file, instruction->result, op1);
+                    finish_definition(ctx, file, instruction->result);
+                    break;
+                case OP_MUL:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        fprintf(file, "    mul %s, %s, %s\n", result_reg, op1_reg, op2_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_DIV:
+                case OP_UNSIGNED_DIV:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        const char * op = instruction->code == OP_UNSIGNED_DIV ? "udiv" : "sdiv";
+                        fprintf(file, "    %s %s, %s, %s\n", op, result_reg, op1_reg, op2_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_SUB:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        fprintf(file, "    sub %s, %s, %s\n", result_reg, op1_reg, op2_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_ADD:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * op2_reg = operand_reg(ctx, file, instruction->op2, "w17");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        fprintf(file, "    add %s, %s, %s\n", result_reg, op1_reg, op2_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_RETURN:
+                    {
+                        if (instruction->op1 != IR_OPERAND_NONE) {
+                            const char * value_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                            fprintf(file, "    mov w0, %s\n", value_reg);
+                        }
 
-                    if (instruction->result->content.function.local_vars_size > 0) {
-                        fprintf(file, "    add sp, sp, #%zu\n", align_up(instruction->result->content.function.local_vars_size, 16));
+                        if (ctx->frame_size > 0) {
+                            emit_sp_adjust(file, "add", ctx->frame_size);
+                        }
+                        fprintf(file, "    ldp x29, x30, [sp], #16\n");
+                        fprintf(file, "    ret\n");
+                    }
+                    break;
+                case OP_STORE_PARAM:
+                    {
+                        size_t offset = op1->content.variable.offset;
+                        int param_index = (int) op2->content.int_value;
+                        if (param_index < IR_REGISTER_ARGUMENT_COUNT) {
+                            snprintf(ctx->buf, CODEGEN_BUF_SIZE, "w%d", param_index);
+                            emit_sp_access(file, "str", ctx->buf, offset);
+                        } else {
+                            /* stack parameters sit above the saved frame record, 8 bytes each */
+                            fprintf(file, "    ldr w16, [x29, #%d]\n", 16 + (param_index - IR_REGISTER_ARGUMENT_COUNT) * 8);
+                            emit_sp_access(file, "str", "w16", offset);
+                        }
                     }
-                    fprintf(file, "    ldp x29, x30, [sp], #16\n");
-                    fprintf(file, "    ret\n");
-                }
-                break;
-            case OP_STORE_PARAM:
-                {
-                    size_t offset = instruction->op1->content.variable.offset;
-                    int param_index = (int) instruction->op2->content.int_value;
-                    fprintf(file, "    str w%d, [sp, #%zu]\n", param_index, offset);
-                }
-                break;
-            case OP_ARG:
-                {
-                    struct codegen_reg * arg_reg = pop_reg(ctx);
-                    int arg_index = (int) instruction->op2->content.int_value;
-                    fprintf(file, "    mov w%d, %s\n", arg_index, arg_reg->name);
-                    free_reg(arg_reg);
-                }
-                break;
-            case OP_CALL:
-                {
-                    size_t saved_active_reg_count = ctx->reg_stack_pos;
-                    size_t spill_memory_size = align_up(saved_active_reg_count * 4, 16);
-
-                    if (saved_active_reg_count > 0) {
-                        fprintf(file, "    sub sp, sp, #%zu\n", spill_memory_size);
-                        for (size_t j = 0; j < saved_active_reg_count; ++j) {
-                            fprintf(file, "    str %s, [sp, #%zu]\n", ctx->reg_stack[j]->name, j * 4);
+                    break;
+                case OP_ARG:
+                    {
+                        const char * arg_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        int arg_index = (int) op2->content.int_value;
+                        if (instruction->result != IR_OPERAND_NONE) {
+                            emit_sp_access(file, "str", arg_reg, result->content.variable.offset);
+                        } else {
+                            fprintf(file, "    mov w%d, %s\n", arg_index, arg_reg);
                         }
                     }
+                    break;
+                case OP_CALL:
+                    {
+                        size_t saved_active_reg_count = ctx->live_count;
+                        size_t spill_memory_size = align_up(saved_active_reg_count * 4, 16);
+
+                        if (saved_active_reg_count > 0) {
+                            emit_sp_adjust(file, "sub", spill_memory_size);
+                            for (size_t j = 0; j < saved_active_reg_count; ++j) {
+                                fprintf(file, "    str %s, [sp, #%zu]\n", ctx->regs[ctx->live[j]->location].name, j * 4);
+                            }
+                        }
 
-                    fprintf(file, "    bl _%s\n", instruction->op1->content.function.identifier->name);
+                        const struct function * callee = &op1->content.function;
+                        unsigned int argument_count = (unsigned int) op2->content.int_value;
+                        size_t stack_argument_size = 0;
 
-                    if (saved_active_reg_count > 0) {
-                        for (size_t j = 0; j < saved_active_reg_count; ++j) {
-                            fprintf(file, "    ldr %s, [sp, #%zu]\n", ctx->reg_stack[j]->name, j * 4);
+                        if (argument_count > IR_REGISTER_ARGUMENT_COUNT) {
+                            stack_argument_size = align_up((argument_count - IR_REGISTER_ARGUMENT_COUNT) * 8, 16);
+                            emit_sp_adjust(file, "sub", stack_argument_size);
+                        }
+
+                        if (callee->staged_arguments != NULL) {
+                            size_t frame_offset = (saved_active_reg_count > 0 ? spill_memory_size : 0) + stack_argument_size;
+                            for (unsigned int j = 0; j < argument_count; ++j) {
+                                const struct ir_operand * slot = ir_function_operand(function, callee->staged_arguments[j]);
+                                if (slot == NULL) {
+                                    continue;
+                                }
+                                if (j < IR_REGISTER_ARGUMENT_COUNT) {
+                                    snprintf(ctx->buf, CODEGEN_BUF_SIZE, "w%u", j);
+                                    emit_sp_access(file, "ldr", ctx->buf, frame_offset + slot->content.variable.offset);
+                                } else {
+                                    emit_sp_access(file, "ldr", "w16", frame_offset + slot->content.variable.offset);
+                                    emit_sp_access(file, "str", "w16", (size_t) (j - IR_REGISTER_ARGUMENT_COUNT) * 8);
+                                }
+                            }
                         }
-                        fprintf(file, "    add sp, sp, #%zu\n", spill_memory_size);
-                    }
 
-                    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-                    fprintf(file, "    mov %s, w0\n", result_reg->name);
-                    push_reg(ctx, result_reg);
-                }
-                break;
-            default:
-                cclynx_fatal_error("ERROR: unknown instruction\n");
+                        fprintf(file, "    bl _%s\n", callee->identifier->name);
+
+                        if (stack_argument_size > 0) {
+                            emit_sp_adjust(file, "add", stack_argument_size);
+                        }
+
+                        if (saved_active_reg_count > 0) {
+                            for (size_t j = 0; j < saved_active_reg_count; ++j) {
+                                fprintf(file, "    ldr %s, [sp, #%zu]\n", ctx->regs[ctx->live[j]->location].name, j * 4);
+                            }
+                            emit_sp_adjust(file, "add", spill_memory_size);
+                        }
+
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        fprintf(file, "    mov %s, w0\n", result_reg);
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_PARAM:
+                    {
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        int param_index = (int) op1->content.int_value;
+                        if (param_index < IR_REGISTER_ARGUMENT_COUNT) {
+                            fprintf(file, "    mov %s, w%d\n", result_reg, param_index);
+                        } else {
+                            fprintf(file, "    ldr %s, [x29, #%d]\n", result_reg, 16 + (param_index - IR_REGISTER_ARGUMENT_COUNT) * 8);
+                        }
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_COPY:
+                    {
+                        const char * op1_reg = operand_reg(ctx, file, instruction->op1, "w16");
+                        const char * result_reg = define_reg(ctx, instruction->result);
+                        if (strcmp(op1_reg, result_reg) != 0) {
+                            fprintf(file, "    mov %s, %s\n", result_reg, op1_reg);
+                        }
+                        finish_definition(ctx, file, instruction->result);
+                    }
+                    break;
+                case OP_PHI:
+                    cclynx_fatal_error("ERROR: phi left in the program for target arm64 generator\n");
+                default:
+                    cclynx_fatal_error("ERROR: unknown instruction\n");
+            }
         }
     }
 
     fflush(file);
 }
 
-void op_const(struct codegen_context * ctx, FILE * output, struct ir_operand * op1)
+void op_const(struct codegen_context * ctx, FILE * output, ir_operand_id result, struct ir_operand * op1)
 {
     assert(ctx != NULL);
     assert(output != NULL);
     assert(op1 != NULL);
     assert(op1->type != NULL);
 
-    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
+    const char * result_reg = define_reg(ctx, result);
 
     unsigned int bits = (unsigned int) op1->content.int_value;
     unsigned int lo = bits & 0xFFFF;
@@ -348,23 +486,20 @@ void op_const(struct codegen_context * ctx, FILE * output, struct ir_operand * o
 
     if (hi == 0) {
         snprintf(ctx->buf, CODEGEN_BUF_SIZE, "%lld", op1->content.int_value);
-        fprintf(output, "    mov %s, #%s\n", result_reg->name, ctx->buf);
+        fprintf(output, "    mov %s, #%s\n", result_reg, ctx->buf);
     } else {
-        fprintf(output, "    movz %s, #0x%x\n", result_reg->name, lo);
-        fprintf(output, "    movk %s, #0x%x, lsl #16\n", result_reg->name, hi);
+        fprintf(output, "    movz %s, #0x%x\n", result_reg, lo);
+        fprintf(output, "    movk %s, #0x%x, lsl #16\n", result_reg, hi);
     }
-
-    push_reg(ctx, result_reg);
 }
 
-void op_load(struct codegen_context * ctx, FILE * output, struct ir_operand * op1)
+void op_load(struct codegen_context * ctx, FILE * output, ir_operand_id result, struct ir_operand * op1)
 {
     assert(ctx != NULL);
     assert(output != NULL);
     assert(op1 != NULL);
     assert(op1->type != NULL);
 
-    struct codegen_reg * result_reg = alloc_reg(ctx, CODEGEN_REG_KIND_INTEGER);
-    fprintf(output, "    ldr %s, [sp, #%zu]\n", result_reg->name, op1->content.variable.offset);
-    push_reg(ctx, result_reg);
+    const char * result_reg = define_reg(ctx, result);
+    emit_sp_access(output, "ldr", result_reg, op1->content.variable.offset);
 }
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+
+#define MAX_LINE_SIZE (1024)
+#define MAX_MARKS (16)
+#define TESTER_BLOB_SIZE (1024)
+#define TESTER_BLOB_ALIGNMENT (16)
+
+static struct memory_blob_pool_mark marks[MAX_MARKS];
+static int mark_count = 0;
+
+
+static void print_state(const struct memory_blob_pool * pool)
+{
+    printf("  blobs=%zu current=%zu used=%zu capacity=%zu large=%zu\n",
+        pool->blob_count,
+        pool->current_blob,
+        pool->blob_count > 0 ? pool->blobs[pool->current_blob]->used : (size_t)0,
+        pool->blob_count > 0 ? pool->blobs[pool->current_blob]->capacity : (size_t)0,
+        pool->large_blob_count
+    );
+}
+
+static void process_command(const char * line, struct memory_blob_pool * pool)
+{
+    char cmd[64] = {0};
+    sscanf(line, "%63s", cmd);
+
+    if (strcmp(cmd, "alloc") == 0) {
+        size_t size = 0;
+        sscanf(line, "alloc %zu", &size);
+
+        unsigned char * memory = memory_blob_pool_alloc(pool, size);
+
+        int zeroed = 1;
+        for (size_t i = 0; i < size; ++i) {
+            if (memory[i] != 0) {
+                zeroed = 0;
+            }
+        }
+
+        /* scribble over the allocation so reuse without clearing is visible */
+        memset(memory, 0xAB, size);
+
+        printf("alloc(%zu) zeroed=%s\n", size, zeroed ? "yes" : "no");
+        print_state(pool);
+        return;
+    }
+
+    if (strcmp(cmd, "mark") == 0) {
+        if (mark_count >= MAX_MARKS) {
+            fprintf(stderr, "ERROR: too many marks\n");
+            exit(1);
+        }
+
+        marks[mark_count] = memory_blob_pool_mark(pool);
+        printf("mark%d = mark()\n", mark_count);
+        ++mark_count;
+        return;
+    }
+
+    if (strcmp(cmd, "rewind") == 0) {
+        int mark_id = 0;
+        sscanf(line, "rewind %d", &mark_id);
+
+        memory_blob_pool_rewind(pool, marks[mark_id]);
+        printf("rewind(mark%d)\n", mark_id);
+        print_state(pool);
+        return;
+    }
+
+    if (strcmp(cmd, "reset") == 0) {
+        memory_blob_pool_reset(pool);
+        printf("reset()\n");
+        print_state(pool);
+        return;
+    }
+}
+
+
+int main(const int argc, const char * argv[])
+{
+    if (argc <= 1) {
+        fprintf(stderr, "No source given!\n");
+        exit(1);
+    }
+
+    FILE * file = fopen(argv[1], "r");
+
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file %s\n", argv[1]);
+        exit(1);
+    }
+
+    struct memory_blob_pool pool;
+    memory_blob_pool_init(&pool, TESTER_BLOB_SIZE, TESTER_BLOB_ALIGNMENT);
+
+    char line[MAX_LINE_SIZE];
+    while (fgets(line, MAX_LINE_SIZE, file) != NULL) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        }
+
+        if (line[0] == '\0') {
+            continue;
+        }
+
+        process_command(line, &pool);
+    }
+
+    memory_blob_pool_free(&pool, false);
+
+    fclose(file);
+
+    return 0;
+}
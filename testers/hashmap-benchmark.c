@@ -0,0 +1,262 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocator.h"
+#include "hashmap.h"
+
+#define BENCHMARK_COPIES (1024)
+#define BENCHMARK_ROUNDS (16)
+#define BENCHMARK_MAX_IDENTIFIER (64)
+#define BENCHMARK_MAX_PROBE_BUCKET (8)
+
+
+struct corpus
+{
+    char ** keys;
+    size_t count;
+    size_t capacity;
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void corpus_add(struct corpus * corpus, const char * key, size_t len)
+{
+    if (corpus->count == corpus->capacity) {
+        corpus->capacity = corpus->capacity == 0 ? 1024 : corpus->capacity * 2;
+        corpus->keys = realloc(corpus->keys, sizeof(char *) * corpus->capacity);
+        if (corpus->keys == NULL) {
+            fprintf(stderr, "ERROR: cannot allocate benchmark corpus\n");
+            exit(1);
+        }
+    }
+
+    char * copy = malloc(len + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "ERROR: cannot allocate benchmark corpus\n");
+        exit(1);
+    }
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+
+    corpus->keys[corpus->count++] = copy;
+}
+
+static int is_identifier_start(int ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+static int is_identifier_char(int ch)
+{
+    return is_identifier_start(ch) || (ch >= '0' && ch <= '9');
+}
+
+/* every distinct identifier-looking word of the file, comments included */
+static void collect_identifiers(struct corpus * corpus, const char * path, struct hashmap * seen)
+{
+    FILE * file = fopen(path, "r");
+
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: cannot open '%s'\n", path);
+        exit(1);
+    }
+
+    char word[BENCHMARK_MAX_IDENTIFIER];
+    size_t len = 0;
+    int ch;
+
+    do {
+        ch = fgetc(file);
+
+        if (len > 0 ? is_identifier_char(ch) : is_identifier_start(ch)) {
+            if (len < sizeof(word) - 1) {
+                word[len++] = (char)ch;
+            }
+            continue;
+        }
+
+        if (len > 0 && hashmap_find(seen, word, len) == NULL) {
+            corpus_add(corpus, word, len);
+            hashmap_insert(seen, corpus->keys[corpus->count - 1], corpus->keys[corpus->count - 1]);
+        }
+        len = 0;
+    } while (ch != EOF);
+
+    fclose(file);
+}
+
+/* generated code reuses the same stems with numeric suffixes */
+static void multiply_corpus(struct corpus * corpus, const struct corpus * base, int copies)
+{
+    char key[BENCHMARK_MAX_IDENTIFIER + 16];
+
+    for (int copy = 0; copy < copies; ++copy) {
+        for (size_t i = 0; i < base->count; ++i) {
+            int len = copy == 0
+                ? snprintf(key, sizeof(key), "%s", base->keys[i])
+                : snprintf(key, sizeof(key), "%s_%d", base->keys[i], copy);
+            corpus_add(corpus, key, (size_t)len);
+        }
+    }
+}
+
+/* the old byte-at-a-time hash, kept here to compare distributions */
+static unsigned int polynomial_hash(const char * key, size_t len)
+{
+    unsigned int hash = 0;
+    for (size_t i = 0; i < len; ++i) {
+        hash = hash * 31 + (unsigned int) key[i];
+    }
+    return hash;
+}
+
+static void report_buckets(const char * name, unsigned int (*hash)(const char *, size_t), const struct corpus * corpus, size_t capacity)
+{
+    size_t * buckets = calloc(capacity, sizeof(size_t));
+
+    if (buckets == NULL) {
+        fprintf(stderr, "ERROR: cannot allocate buckets\n");
+        exit(1);
+    }
+
+    double start = now_seconds();
+    unsigned int checksum = 0;
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        for (size_t i = 0; i < corpus->count; ++i) {
+            checksum += hash(corpus->keys[i], strlen(corpus->keys[i]));
+        }
+    }
+    double seconds = now_seconds() - start;
+
+    for (size_t i = 0; i < corpus->count; ++i) {
+        ++buckets[hash(corpus->keys[i], strlen(corpus->keys[i])) & (capacity - 1)];
+    }
+
+    size_t empty = 0;
+    size_t longest = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (buckets[i] == 0) {
+            ++empty;
+        }
+        if (buckets[i] > longest) {
+            longest = buckets[i];
+        }
+    }
+
+    printf("%-12s %12.1f %14.1f%% %14zu   (checksum %08x)\n",
+        name,
+        (double)corpus->count * BENCHMARK_ROUNDS / seconds / 1e6,
+        100.0 * (double)empty / (double)capacity,
+        longest,
+        checksum);
+
+    free(buckets);
+}
+
+int main(const int argc, const char * argv[])
+{
+    if (argc <= 1) {
+        fprintf(stderr, "usage: hashmap-benchmark <file.c>...\n");
+        exit(1);
+    }
+
+    struct memory_blob_pool pool;
+    memory_blob_pool_init(&pool, DEFAULT_MEMORY_BLOB_SIZE, DEFAULT_MEMORY_BLOB_ALIGNMENT);
+
+    struct corpus base = {NULL, 0, 0};
+    struct hashmap seen;
+    hashmap_init(&seen, 0, &pool);
+
+    for (int i = 1; i < argc; ++i) {
+        collect_identifiers(&base, argv[i], &seen);
+    }
+
+    struct corpus corpus = {NULL, 0, 0};
+    multiply_corpus(&corpus, &base, BENCHMARK_COPIES);
+
+    printf("%zu distinct identifiers in %d files, %zu keys after multiplying by %d\n\n",
+        base.count, argc - 1, corpus.count, BENCHMARK_COPIES);
+
+    struct hashmap map;
+    hashmap_init(&map, 0, &pool);
+
+    double start = now_seconds();
+    for (size_t i = 0; i < corpus.count; ++i) {
+        hashmap_insert(&map, corpus.keys[i], corpus.keys[i]);
+    }
+    double insert_seconds = now_seconds() - start;
+
+    size_t found = 0;
+    start = now_seconds();
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        for (size_t i = 0; i < corpus.count; ++i) {
+            found += hashmap_find(&map, corpus.keys[i], strlen(corpus.keys[i])) != NULL;
+        }
+    }
+    double hit_seconds = now_seconds() - start;
+
+    char missing[BENCHMARK_MAX_IDENTIFIER + 16];
+    size_t false_hits = 0;
+    start = now_seconds();
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        for (size_t i = 0; i < base.count; ++i) {
+            int len = snprintf(missing, sizeof(missing), "%s_x%d", base.keys[i], round);
+            false_hits += hashmap_find(&map, missing, (size_t)len) != NULL;
+        }
+    }
+    double miss_seconds = now_seconds() - start;
+
+    printf("insert      %10.1f M keys/s\n", (double)corpus.count / insert_seconds / 1e6);
+    printf("find (hit)  %10.1f M keys/s\n", (double)corpus.count * BENCHMARK_ROUNDS / hit_seconds / 1e6);
+    printf("find (miss) %10.1f M keys/s\n\n", (double)base.count * BENCHMARK_ROUNDS / miss_seconds / 1e6);
+
+    /* distance of every entry from its home slot */
+    size_t probes[BENCHMARK_MAX_PROBE_BUCKET + 1] = {0};
+    size_t total_distance = 0;
+    size_t mask = map.capacity - 1;
+    for (size_t i = 0; i < map.capacity; ++i) {
+        if (map.entries[i].key == NULL) {
+            continue;
+        }
+        size_t distance = (i - map.entries[i].hash) & mask;
+        total_distance += distance;
+        ++probes[distance < BENCHMARK_MAX_PROBE_BUCKET ? distance : BENCHMARK_MAX_PROBE_BUCKET];
+    }
+
+    printf("%zu entries in %zu slots, mean probe distance %.3f\n", map.count, map.capacity, (double)total_distance / (double)map.count);
+    for (size_t i = 0; i <= BENCHMARK_MAX_PROBE_BUCKET; ++i) {
+        printf("  distance %s%zu %10zu\n", i == BENCHMARK_MAX_PROBE_BUCKET ? ">=" : "  ", i, probes[i]);
+    }
+
+    printf("\n%-12s %12s %15s %14s\n", "hash", "M hashes/s", "empty buckets", "longest chain");
+    report_buckets("word", hashmap_hash, &corpus, map.capacity);
+    report_buckets("polynomial", polynomial_hash, &corpus, map.capacity);
+
+    int exit_code = 0;
+
+    if (found != corpus.count * BENCHMARK_ROUNDS || false_hits != 0 || map.count != corpus.count) {
+        fprintf(stderr, "ERROR: map returned wrong results\n");
+        exit_code = 1;
+    }
+
+    for (size_t i = 0; i < corpus.count; ++i) {
+        free(corpus.keys[i]);
+    }
+    for (size_t i = 0; i < base.count; ++i) {
+        free(base.keys[i]);
+    }
+    free(corpus.keys);
+    free(base.keys);
+    memory_blob_pool_free(&pool, false);
+
+    return exit_code;
+}
@@ -64,6 +64,65 @@ static void process_command(const char * line, struct memory_blob_pool * pool)
         return;
     }
 
+    if (strcmp(cmd, "fill") == 0) {
+        int map_id = 0;
+        int count = 0;
+        char prefix[64] = {0};
+        sscanf(line, "fill %d %63s %d", &map_id, prefix, &count);
+
+        for (int i = 0; i < count; ++i) {
+            char key[128];
+            int len = snprintf(key, sizeof(key), "%s%d", prefix, i);
+
+            char * stored_key = memory_blob_pool_alloc(pool, (size_t)len + 1);
+            memcpy(stored_key, key, (size_t)len + 1);
+
+            hashmap_insert(&maps[map_id], stored_key, stored_key);
+        }
+
+        printf("map%d.fill(\"%s\", %d)\n", map_id, prefix, count);
+        return;
+    }
+
+    if (strcmp(cmd, "verify") == 0) {
+        int map_id = 0;
+        int count = 0;
+        char prefix[64] = {0};
+        sscanf(line, "verify %d %63s %d", &map_id, prefix, &count);
+
+        int found = 0;
+        int mismatched = 0;
+
+        /* keys past count were never inserted and must not be found */
+        for (int i = 0; i < count * 2; ++i) {
+            char key[128];
+            int len = snprintf(key, sizeof(key), "%s%d", prefix, i);
+
+            const char * result = hashmap_find(&maps[map_id], key, (size_t)len);
+
+            if (i < count && (result == NULL || strcmp(result, key) != 0)) {
+                ++mismatched;
+            } else if (i >= count && result != NULL) {
+                ++mismatched;
+            }
+
+            if (result != NULL) {
+                ++found;
+            }
+        }
+
+        printf("map%d.verify(\"%s\", %d) = %d found, %d mismatched\n", map_id, prefix, count, found, mismatched);
+        return;
+    }
+
+    if (strcmp(cmd, "size") == 0) {
+        int map_id = 0;
+        sscanf(line, "size %d", &map_id);
+
+        printf("map%d.size() = %zu\n", map_id, maps[map_id].count);
+        return;
+    }
+
     if (strcmp(cmd, "hash") == 0) {
         char key[256] = {0};
         sscanf(line, "hash %255s", key);
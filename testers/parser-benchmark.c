@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cclynx.h"
+#include "parser.h"
+#include "scan.h"
+#include "source.h"
+#include "symbol.h"
+#include "tokenizer.h"
+#include "warning.h"
+
+#define BENCHMARK_DEFAULT_LOCAL_COUNT (50000)
+#define BENCHMARK_ROUNDS (5)
+#define BENCHMARK_SIZE_STEPS (3)
+
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void * checked_malloc(size_t size)
+{
+    void * ptr = malloc(size);
+    if (ptr == NULL) {
+        fprintf(stderr, "ERROR: cannot allocate %zu bytes\n", size);
+        exit(1);
+    }
+    return ptr;
+}
+
+/*
+ * One function with every local in its body scope, the way generated state
+ * machines look, plus an inner block that shadows a slice of them.
+ */
+static void make_input(struct source * input, unsigned int local_count)
+{
+    size_t capacity = (size_t)local_count * 64 + 256;
+    char * content = checked_malloc(capacity);
+    size_t size = 0;
+
+    size += sprintf(content + size, "int main(void)\n{\n    int v0;\n    v0 = 0;\n");
+
+    for (unsigned int i = 1; i < local_count; ++i) {
+        size += sprintf(content + size, "    int v%u;\n    v%u = v%u + 1;\n", i, i, i - 1);
+    }
+
+    size += sprintf(content + size, "    {\n");
+    for (unsigned int i = 0; i < local_count / 16; ++i) {
+        size += sprintf(content + size, "        int v%u;\n        v%u = v%u;\n", i, i, local_count - 1);
+    }
+    size += sprintf(content + size, "    }\n    return v%u;\n}\n", local_count - 1);
+
+    memset(input, 0, sizeof(struct source));
+    input->content = content;
+    input->path = "benchmark";
+    input->size = size;
+}
+
+/* the fastest of a few rounds, each one on a fresh context */
+static double parse_input(struct source * input, int * has_error)
+{
+    double best = 1e9;
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        struct cclynx_context ctx;
+        cclynx_init(&ctx);
+        cclynx_reset(&ctx);
+        input->cursor = 0;
+
+        double start = now_seconds();
+
+        struct tokenizer_context tokenizer;
+        tokenizer_init(&tokenizer, &ctx.identifier_table, &ctx.pool);
+        init_symbols(&ctx.identifier_table, &ctx.pool);
+
+        struct token_stream stream;
+        token_stream_init(&stream, &tokenizer, input);
+
+        struct parser_context parser;
+        parser_init_context(&parser, &stream, &ctx.pool, &ctx.global_scope, input->path);
+        warning_init_default(&parser.warning_flags);
+        parser_parse(&parser);
+
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+
+        *has_error |= parser.has_error;
+        cclynx_free(&ctx);
+    }
+
+    return best;
+}
+
+int main(const int argc, const char * argv[])
+{
+    unsigned int local_count = BENCHMARK_DEFAULT_LOCAL_COUNT;
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: parser-benchmark [local-count]\n");
+        exit(1);
+    }
+
+    if (argc == 2) {
+        local_count = (unsigned int) strtoul(argv[1], NULL, 10);
+        if (local_count < 16) {
+            fprintf(stderr, "ERROR: the local count must be at least 16\n");
+            exit(1);
+        }
+    }
+
+    scan_init();
+
+    int has_error = 0;
+    double previous_seconds = 0.0;
+
+    printf("%-10s %12s %12s %14s %8s\n", "locals", "bytes", "parse ms", "decls/s", "growth");
+
+    /* doubling the locals should roughly double the time, not quadruple it */
+    for (int step = BENCHMARK_SIZE_STEPS - 1; step >= 0; --step) {
+        unsigned int count = local_count >> step;
+        struct source input;
+        make_input(&input, count);
+
+        double seconds = parse_input(&input, &has_error);
+        double declarations = (double)(count + count / 16);
+
+        printf("%-10u %12zu %12.2f %14.0f", count, input.size, seconds * 1e3, declarations / seconds);
+        if (previous_seconds > 0.0) {
+            printf(" %7.2fx\n", seconds / previous_seconds);
+        } else {
+            printf(" %8s\n", "-");
+        }
+
+        previous_seconds = seconds;
+        free(input.content);
+    }
+
+    if (has_error) {
+        fprintf(stderr, "ERROR: the generated input did not parse\n");
+        return 1;
+    }
+
+    return 0;
+}
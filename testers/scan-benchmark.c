@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scan.h"
+
+#define BENCHMARK_BUFFER_SIZE (16 * 1024 * 1024)
+#define BENCHMARK_ROUNDS (8)
+
+
+struct scan_totals
+{
+    size_t stops;
+    size_t offsets; /* sum of the offsets the scanner stopped at, to compare scanners */
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* runs of indentation and blank lines between single-byte tokens */
+static char * make_whitespace_input(size_t size)
+{
+    static const char fill[] = {' ', ' ', ' ', ' ', '\t', '\n', ' ', '\r'};
+
+    char * buffer = malloc(size + 1);
+    if (buffer == NULL) {
+        fprintf(stderr, "ERROR: cannot allocate benchmark input\n");
+        exit(1);
+    }
+
+    srand(42);
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 8 + (size_t)(rand() % 120);
+        for (size_t j = 0; j < run && i < size; ++j) {
+            buffer[i++] = fill[rand() % (int)sizeof(fill)];
+        }
+        if (i < size) {
+            buffer[i++] = 'x';
+        }
+    }
+    buffer[size] = '\0';
+
+    return buffer;
+}
+
+/* license-style block comments separated by a token */
+static char * make_comment_input(size_t size)
+{
+    static const char line[] = " * Permission is hereby granted, free of charge, to any person obtaining a copy\n";
+
+    char * buffer = malloc(size + 1);
+    if (buffer == NULL) {
+        fprintf(stderr, "ERROR: cannot allocate benchmark input\n");
+        exit(1);
+    }
+
+    size_t i = 0;
+    while (i < size) {
+        size_t lines = 5 + (size_t)(i % 17);
+        for (size_t j = 0; j < lines && i < size; ++j) {
+            for (size_t k = 0; k < sizeof(line) - 1 && i < size; ++k) {
+                buffer[i++] = line[k];
+            }
+        }
+        if (i + 3 <= size) {
+            memcpy(buffer + i, "*/x", 3);
+            i += 3;
+        } else {
+            while (i < size) {
+                buffer[i++] = ' ';
+            }
+        }
+    }
+    buffer[size] = '\0';
+
+    return buffer;
+}
+
+static struct scan_totals run_whitespace(scan_whitespace_fn skip_whitespace, const char * buffer, size_t size)
+{
+    struct scan_totals totals = {0, 0};
+    const char * end = buffer + size;
+    const char * p = buffer;
+
+    while (p < end) {
+        p = skip_whitespace(p, end);
+        if (p < end) {
+            ++totals.stops;
+            totals.offsets += (size_t)(p - buffer);
+            ++p;
+        }
+    }
+
+    return totals;
+}
+
+static struct scan_totals run_comments(scan_comment_end_fn find_comment_end, const char * buffer, size_t size)
+{
+    struct scan_totals totals = {0, 0};
+    const char * end = buffer + size;
+    const char * p = buffer;
+
+    while (p < end) {
+        const char * comment_end = find_comment_end(p, end);
+        if (comment_end == NULL) {
+            break;
+        }
+        ++totals.stops;
+        totals.offsets += (size_t)(comment_end - buffer);
+        p = comment_end + 2;
+    }
+
+    return totals;
+}
+
+int main(void)
+{
+    char * whitespace_input = make_whitespace_input(BENCHMARK_BUFFER_SIZE);
+    char * comment_input = make_comment_input(BENCHMARK_BUFFER_SIZE);
+
+    size_t count = 0;
+    const struct scan_implementation * implementations = scan_available_implementations(&count);
+
+    struct scan_totals expected_whitespace = run_whitespace(implementations[count - 1].skip_whitespace, whitespace_input, BENCHMARK_BUFFER_SIZE);
+    struct scan_totals expected_comments = run_comments(implementations[count - 1].find_comment_end, comment_input, BENCHMARK_BUFFER_SIZE);
+
+    printf("%-8s %16s %16s\n", "scanner", "whitespace MB/s", "comments MB/s");
+
+    int exit_code = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        struct scan_totals whitespace = {0, 0};
+        struct scan_totals comments = {0, 0};
+
+        double start = now_seconds();
+        for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+            whitespace = run_whitespace(implementations[i].skip_whitespace, whitespace_input, BENCHMARK_BUFFER_SIZE);
+        }
+        double whitespace_seconds = now_seconds() - start;
+
+        start = now_seconds();
+        for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+            comments = run_comments(implementations[i].find_comment_end, comment_input, BENCHMARK_BUFFER_SIZE);
+        }
+        double comment_seconds = now_seconds() - start;
+
+        double megabytes = (double)BENCHMARK_BUFFER_SIZE * BENCHMARK_ROUNDS / 1e6;
+
+        printf("%-8s %16.1f %16.1f\n", implementations[i].name, megabytes / whitespace_seconds, megabytes / comment_seconds);
+
+        if (
+            whitespace.stops != expected_whitespace.stops
+            || whitespace.offsets != expected_whitespace.offsets
+            || comments.stops != expected_comments.stops
+            || comments.offsets != expected_comments.offsets
+        ) {
+            fprintf(stderr, "ERROR: %s scanner disagrees with the scalar one\n", implementations[i].name);
+            exit_code = 1;
+        }
+    }
+
+    free(whitespace_input);
+    free(comment_input);
+
+    return exit_code;
+}
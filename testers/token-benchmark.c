@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocator.h"
+#include "hashmap.h"
+#include "identifier.h"
+#include "scan.h"
+#include "source.h"
+#include "tokenizer.h"
+
+#define BENCHMARK_INPUT_SIZE (16 * 1024 * 1024)
+#define BENCHMARK_ROUNDS (5)
+
+
+struct token_columns
+{
+    struct identifier ** identifiers;
+    uint32_t * offsets;
+    uint32_t * lengths;
+    int16_t * kinds;
+    uint8_t * flags;
+    size_t count;
+};
+
+/* the fastest round is kept, the machine may be busy with something else */
+struct layout_result
+{
+    double lex_seconds;
+    double walk_seconds;
+    size_t tokens;
+    size_t checksum;
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double min_seconds(double a, double b)
+{
+    return a < b ? a : b;
+}
+
+static void * checked_malloc(size_t size)
+{
+    void * ptr = malloc(size);
+    if (ptr == NULL) {
+        fprintf(stderr, "ERROR: cannot allocate %zu bytes\n", size);
+        exit(1);
+    }
+    return ptr;
+}
+
+/* the given files repeated up to BENCHMARK_INPUT_SIZE, as one source */
+static void make_input(struct source * input, int file_count, const char * paths[])
+{
+    char * content = checked_malloc(BENCHMARK_INPUT_SIZE + 1);
+    size_t size = 0;
+    int full = 0;
+
+    while (!full) {
+        for (int i = 0; i < file_count && !full; ++i) {
+            struct source source;
+            source_load(&source, paths[i]);
+
+            if (size + source.size + 1 > BENCHMARK_INPUT_SIZE) {
+                full = 1;
+            } else {
+                memcpy(content + size, source.content, source.size);
+                size += source.size;
+                content[size++] = '\n';
+            }
+
+            source_free(&source);
+        }
+    }
+    content[size] = '\0';
+
+    memset(input, 0, sizeof(struct source));
+    input->content = content;
+    input->path = "benchmark";
+    input->size = size;
+}
+
+static void reset_tokenizer(struct tokenizer_context * tokenizer, struct hashmap * table, struct memory_blob_pool * pool, struct source * input)
+{
+    memory_blob_pool_reset(pool);
+    identifier_table_init(table, pool);
+    tokenizer_init(tokenizer, table, pool);
+    input->cursor = 0;
+}
+
+/* one struct token per element, as a growing array */
+static struct layout_result run_array_of_structs(struct source * input, struct memory_blob_pool * pool)
+{
+    struct layout_result result = {1e9, 1e9, 0, 0};
+    struct tokenizer_context tokenizer;
+    struct hashmap table;
+
+    size_t capacity = input->size / 2 + 1;
+    struct token * tokens = checked_malloc(sizeof(struct token) * capacity);
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        reset_tokenizer(&tokenizer, &table, pool, input);
+
+        double start = now_seconds();
+        size_t count = 0;
+        do {
+            tokenizer_get_one_token(&tokenizer, input, &tokens[count]);
+        } while (tokens[count++].kind != TOKEN_KIND_EOS);
+        result.lex_seconds = min_seconds(result.lex_seconds, now_seconds() - start);
+
+        start = now_seconds();
+        size_t checksum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (tokens[i].kind == TOKEN_KIND_IDENTIFIER) {
+                checksum += tokens[i].span.offset;
+            }
+        }
+        result.walk_seconds = min_seconds(result.walk_seconds, now_seconds() - start);
+
+        result.tokens = count;
+        result.checksum = checksum;
+    }
+
+    free(tokens);
+    return result;
+}
+
+/* parallel arrays, filled a block at a time like the token stream does */
+static struct layout_result run_struct_of_arrays(struct source * input, struct memory_blob_pool * pool)
+{
+    struct layout_result result = {1e9, 1e9, 0, 0};
+    struct tokenizer_context tokenizer;
+    struct hashmap table;
+    struct token_block * block = checked_malloc(sizeof(struct token_block));
+
+    size_t capacity = input->size / 2 + TOKEN_BLOCK_SIZE;
+    struct token_columns columns;
+    columns.identifiers = checked_malloc(sizeof(struct identifier *) * capacity);
+    columns.offsets = checked_malloc(sizeof(uint32_t) * capacity);
+    columns.lengths = checked_malloc(sizeof(uint32_t) * capacity);
+    columns.kinds = checked_malloc(sizeof(int16_t) * capacity);
+    columns.flags = checked_malloc(sizeof(uint8_t) * capacity);
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        reset_tokenizer(&tokenizer, &table, pool, input);
+
+        double start = now_seconds();
+        size_t count = 0;
+        do {
+            token_block_fill(block, &tokenizer, input);
+            memcpy(columns.identifiers + count, block->identifiers, sizeof(struct identifier *) * block->count);
+            memcpy(columns.offsets + count, block->offsets, sizeof(uint32_t) * block->count);
+            memcpy(columns.lengths + count, block->lengths, sizeof(uint32_t) * block->count);
+            memcpy(columns.kinds + count, block->kinds, sizeof(int16_t) * block->count);
+            memcpy(columns.flags + count, block->flags, sizeof(uint8_t) * block->count);
+            count += block->count;
+        } while (columns.kinds[count - 1] != TOKEN_KIND_EOS);
+        result.lex_seconds = min_seconds(result.lex_seconds, now_seconds() - start);
+
+        start = now_seconds();
+        size_t checksum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (columns.kinds[i] == TOKEN_KIND_IDENTIFIER) {
+                checksum += columns.offsets[i];
+            }
+        }
+        result.walk_seconds = min_seconds(result.walk_seconds, now_seconds() - start);
+
+        result.tokens = count;
+        result.checksum = checksum;
+    }
+
+    free(columns.identifiers);
+    free(columns.offsets);
+    free(columns.lengths);
+    free(columns.kinds);
+    free(columns.flags);
+    free(block);
+    return result;
+}
+
+/* what the parser sees: blocks unpacked into the lookahead ring */
+static struct layout_result run_stream(struct source * input, struct memory_blob_pool * pool)
+{
+    struct layout_result result = {1e9, 1e9, 0, 0};
+    struct tokenizer_context tokenizer;
+    struct hashmap table;
+    struct token_stream * stream = checked_malloc(sizeof(struct token_stream));
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; ++round) {
+        reset_tokenizer(&tokenizer, &table, pool, input);
+        token_stream_init(stream, &tokenizer, input);
+
+        double start = now_seconds();
+        size_t count = 0;
+        size_t checksum = 0;
+        struct token * token;
+        do {
+            token = token_stream_next(stream);
+            if (token->kind == TOKEN_KIND_IDENTIFIER) {
+                checksum += token->span.offset;
+            }
+            ++count;
+        } while (token != &eos_token);
+        result.lex_seconds = min_seconds(result.lex_seconds, now_seconds() - start);
+
+        result.tokens = count;
+        result.checksum = checksum;
+    }
+
+    free(stream);
+    return result;
+}
+
+static void report(const char * name, struct layout_result result, size_t bytes_per_token)
+{
+    double tokens = (double)result.tokens;
+
+    printf("%-18s %14.1f", name, tokens / result.lex_seconds / 1e6);
+
+    if (result.walk_seconds < 1e9) {
+        printf(" %14.1f %14zu\n", tokens / result.walk_seconds / 1e6, bytes_per_token);
+    } else {
+        printf(" %14s %14s\n", "-", "-");
+    }
+}
+
+int main(const int argc, const char * argv[])
+{
+    if (argc <= 1) {
+        fprintf(stderr, "usage: token-benchmark <file.c>...\n");
+        exit(1);
+    }
+
+    scan_init();
+
+    struct source input;
+    make_input(&input, argc - 1, argv + 1);
+
+    struct memory_blob_pool pool;
+    memory_blob_pool_init(&pool, DEFAULT_MEMORY_BLOB_SIZE, DEFAULT_MEMORY_BLOB_ALIGNMENT);
+
+    struct layout_result array_of_structs = run_array_of_structs(&input, &pool);
+    struct layout_result struct_of_arrays = run_struct_of_arrays(&input, &pool);
+    struct layout_result stream = run_stream(&input, &pool);
+
+    printf("%zu tokens in %zu bytes\n\n", array_of_structs.tokens, input.size);
+    printf("%-18s %14s %14s %14s\n", "layout", "lex Mtok/s", "walk Mtok/s", "bytes/token");
+
+    size_t column_bytes = sizeof(struct identifier *) + sizeof(uint32_t) * 2 + sizeof(int16_t) + sizeof(uint8_t);
+
+    report("array of structs", array_of_structs, sizeof(struct token));
+    report("struct of arrays", struct_of_arrays, column_bytes);
+    report("stream", stream, 0);
+
+    int exit_code = 0;
+
+    if (
+        array_of_structs.tokens != struct_of_arrays.tokens
+        || array_of_structs.checksum != struct_of_arrays.checksum
+        || array_of_structs.checksum != stream.checksum
+    ) {
+        fprintf(stderr, "ERROR: layouts disagree\n");
+        exit_code = 1;
+    }
+
+    memory_blob_pool_free(&pool, false);
+    free(input.content);
+
+    return exit_code;
+}
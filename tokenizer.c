@@ -1,6 +1,5 @@
 #include <assert.h>
 #include <stdio.h>
-#include <ctype.h>
 #include <string.h>
 
 #include "tokenizer.h"
@@ -9,14 +8,59 @@
 #include "identifier.h"
 #include "error.h"
 #include "source.h"
-
-
-struct token eos_token = {NULL, NULL, &eos_token, {0, 0, {0, 0}}, 0, TOKEN_KIND_EOS};
-
-static void read_identifier(struct tokenizer_context * ctx, struct source * source, struct token * token, int ch, uint32_t span_start, uint32_t span_line, uint32_t span_column);
-static void read_number(struct tokenizer_context * ctx, struct source * source, struct token * token, int ch, uint32_t span_start, uint32_t span_line, uint32_t span_column);
-static void skip_single_line_comment(struct tokenizer_context * ctx, struct source * source);
-static void skip_multi_line_comment(struct tokenizer_context * ctx, struct source * source);
+#include "scan.h"
+
+
+/* shared by every translation unit and thread, never written */
+struct token eos_token = {NULL, {0, 0}, TOKEN_KIND_EOS, 0, '\0'};
+
+#define CHAR_CLASS_SPACE       (1 << 0)
+#define CHAR_CLASS_ALPHA       (1 << 2)
+#define CHAR_CLASS_IDENTIFIER  (1 << 3)
+#define CHAR_CLASS_DIGIT       (1 << 4)
+#define CHAR_CLASS_PUNCTUATOR  (1 << 5)
+
+#define SP (CHAR_CLASS_SPACE)
+#define AL (CHAR_CLASS_ALPHA | CHAR_CLASS_IDENTIFIER)
+#define DG (CHAR_CLASS_DIGIT | CHAR_CLASS_IDENTIFIER)
+#define US (CHAR_CLASS_IDENTIFIER)
+#define PU (CHAR_CLASS_PUNCTUATOR)
+
+/* single-character punctuators only, '/', '=', '!' and '.' need a second look */
+static const unsigned char char_class[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0, SP, SP, SP, SP, SP,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    SP,  0,  0,  0,  0,  0,  0,  0, PU, PU, PU, PU, PU, PU,  0,  0,
+    DG, DG, DG, DG, DG, DG, DG, DG, DG, DG,  0, PU, PU,  0, PU,  0,
+     0, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+    AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,  0,  0,  0,  0, US,
+     0, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+    AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, PU,  0, PU,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+#undef SP
+#undef AL
+#undef DG
+#undef US
+#undef PU
+
+#define char_class_of(ch) (char_class[(unsigned char)(ch)])
+
+/* whitespace runs longer than this are handed to the vector scanner */
+#define SHORT_WHITESPACE_RUN (4)
+
+static const char * read_identifier(struct tokenizer_context * ctx, struct source * source, struct token * token, const char * start);
+static const char * read_number(struct tokenizer_context * ctx, struct source * source, struct token * token, const char * start);
+static const char * skip_whitespace(struct source * source, const char * p, const char * end);
+static const char * skip_multi_line_comment(struct source * source, const char * p, const char * end);
 
 
 void tokenizer_init(struct tokenizer_context * ctx, struct hashmap * identifier_table, struct memory_blob_pool * pool)
@@ -29,35 +73,96 @@ void tokenizer_init(struct tokenizer_context * ctx, struct hashmap * identifier_
     ctx->identifier_table = identifier_table;
 }
 
-struct token * tokenizer_tokenize_file(struct tokenizer_context * ctx, struct source * source)
+void token_stream_init(struct token_stream * stream, struct tokenizer_context * tokenizer, struct source * source)
 {
-    assert(ctx != NULL);
+    assert(stream != NULL);
+    assert(tokenizer != NULL);
     assert(source != NULL);
+    memset(stream, 0, sizeof(struct token_stream));
+    stream->tokenizer = tokenizer;
+    stream->source = source;
+}
 
-    struct token * tokens = &eos_token;
-    struct token ** next_token = &tokens;
+void token_block_fill(struct token_block * block, struct tokenizer_context * tokenizer, struct source * source)
+{
+    assert(block != NULL);
+    assert(tokenizer != NULL);
+    assert(source != NULL);
 
-    for (;;) {
-        struct token temp;
-        memset(&temp, 0, sizeof(struct token));
+    struct token token;
+    unsigned int count = 0;
 
-        tokenizer_get_one_token(ctx, source, &temp);
+    do {
+        tokenizer_get_one_token(tokenizer, source, &token);
+        block->identifiers[count] = token.identifier;
+        block->offsets[count] = token.span.offset;
+        block->lengths[count] = token.span.length;
+        block->kinds[count] = (int16_t)token.kind;
+        block->flags[count] = token.flags;
+        ++count;
+    } while (count < TOKEN_BLOCK_SIZE && token.kind != TOKEN_KIND_EOS && token.kind != TOKEN_KIND_ERROR);
+
+    block->count = count;
+    block->next = 0;
+}
 
-        if (temp.kind == TOKEN_KIND_EOS) {
-            *next_token = &eos_token;
-            break;
-        }
+struct token * token_stream_next(struct token_stream * stream)
+{
+    assert(stream != NULL);
+
+    if (stream->at_end) {
+        return &eos_token;
+    }
+
+    struct token_block * block = &stream->block;
+
+    if (block->next == block->count) {
+        token_block_fill(block, stream->tokenizer, stream->source);
+    }
 
-        struct token * token = memory_blob_pool_alloc(ctx->pool, sizeof(struct token));
-        *token = temp;
-        token->next = &eos_token;
-        *next_token = token;
-        next_token = &token->next;
+    unsigned int index = block->next++;
+
+    switch (block->kinds[index]) {
+        case TOKEN_KIND_EOS:
+            stream->at_end = true;
+            return &eos_token;
+        case TOKEN_KIND_ERROR:
+            /* seen only once the tokens before it have been consumed, the stream ends there */
+            stream->error = stream->tokenizer->error;
+            stream->at_end = true;
+            return &eos_token;
     }
 
-    return tokens;
+    struct token * token = &stream->ring[stream->next_slot];
+    stream->next_slot = (stream->next_slot + 1) & (TOKEN_STREAM_RING_SIZE - 1);
+
+    token->identifier = block->identifiers[index];
+    token->span.offset = block->offsets[index];
+    token->span.length = block->lengths[index];
+    token->kind = block->kinds[index];
+    token->flags = block->flags[index];
+    token->first_ch = stream->source->content[token->span.offset];
+
+    return token;
 }
 
+static void set_token(struct token * token, int kind, const struct source * source, const char * start, uint32_t length)
+{
+    uint32_t offset = (uint32_t)(start - source->content);
+
+    token->kind = kind;
+    token->span.offset = offset;
+    token->span.length = length;
+    token->first_ch = *start;
+}
+
+static void set_error_token(struct tokenizer_context * ctx, struct token * token, const char * message)
+{
+    ctx->error = message;
+    token->kind = TOKEN_KIND_ERROR;
+    token->span.offset = 0;
+    token->span.length = 0;
+}
 
 void tokenizer_get_one_token(struct tokenizer_context * ctx, struct source * source, struct token * token)
 {
@@ -65,213 +170,156 @@ void tokenizer_get_one_token(struct tokenizer_context * ctx, struct source * sou
     assert(source != NULL);
     assert(token != NULL);
 
-    token->source = source;
     token->identifier = NULL;
+    token->flags = 0;
+    token->first_ch = '\0';
 
-    for (;;) {
-        int ch = source_get_char(source);
+    const char * content = source->content;
+    const char * end = content + source->size;
+    const char * p = content + source->cursor;
 
-        while (isspace(ch)) {
-            ch = source_get_char(source);
+    for (;;) {
+        if (char_class_of(*p) & CHAR_CLASS_SPACE) {
+            p = skip_whitespace(source, p, end);
         }
 
-        if (ch == EOF) {
+        if (p == end) {
             token->kind = TOKEN_KIND_EOS;
             token->span.offset = 0;
             token->span.length = 0;
+            source->cursor = source->size;
             return;
         }
 
-        uint32_t span_start = (uint32_t)(source->cursor - 1);
-        uint32_t span_line = source->line;
-        uint32_t span_column = source->column - 1;
-
-        if (ch == '/') {
-            int next_char = source_get_char(source);
-
-            if (next_char == '/') {
-                skip_single_line_comment(ctx, source);
-                continue;
-            }
-
-            if (next_char == '*') {
-                skip_multi_line_comment(ctx, source);
-                continue;
-            }
-
-            source_unget_char(source, next_char);
-            token->kind = TOKEN_KIND_PUNCTUATOR;
-            token->span.offset = span_start;
-            token->span.length = 1;
-            token->span.position.line = span_line;
-            token->span.position.column = span_column;
-            return;
-        }
-
-        if (is_start_identifier_char(ch)) {
-            read_identifier(ctx, source, token, ch, span_start, span_line, span_column);
-            return;
-        }
-
-        if (ch == '.') {
-            int next_char = source_get_char(source);
-            if (isdigit(next_char)) {
-                source_unget_char(source, next_char);
-                read_number(ctx, source, token, ch, span_start, span_line, span_column);
-                return;
-            }
-            source_unget_char(source, next_char);
-        }
-
-        if (isdigit(ch)) {
-            read_number(ctx, source, token, ch, span_start, span_line, span_column);
-            return;
-        }
-
-        switch (ch) {
-            case '=':
-                {
-                    int next_char = source_get_char(source);
-
-                    if (next_char == '=') {
-                        token->kind = TOKEN_KIND_EQUAL_PUNCTUATOR;
-                        token->span.offset = span_start;
-                        token->span.length = 2;
-                        token->span.position.line = span_line;
-                        token->span.position.column = span_column;
+        const char * start = p;
+        unsigned char ch = (unsigned char)*p;
+        unsigned char class = char_class_of(ch);
+
+        if (class & CHAR_CLASS_ALPHA) {
+            p = read_identifier(ctx, source, token, start);
+        } else if (class & CHAR_CLASS_DIGIT) {
+            p = read_number(ctx, source, token, start);
+        } else if (class & CHAR_CLASS_PUNCTUATOR) {
+            set_token(token, TOKEN_KIND_PUNCTUATOR, source, start, 1);
+            p = start + 1;
+        } else {
+            switch (ch) {
+                case '/':
+                    if (p[1] == '/') {
+                        const char * newline = memchr(p + 2, '\n', (size_t)(end - p - 2));
+                        p = newline != NULL ? newline : end;
+                        continue;
+                    }
+                    if (p[1] == '*') {
+                        p = skip_multi_line_comment(source, p + 2, end);
+                        if (p == NULL) {
+                            set_error_token(ctx, token, "ERROR: unterminated comment\n");
+                            return;
+                        }
+                        continue;
+                    }
+                    set_token(token, TOKEN_KIND_PUNCTUATOR, source, start, 1);
+                    p = start + 1;
+                    break;
+                case '=':
+                    if (p[1] == '=') {
+                        set_token(token, TOKEN_KIND_EQUAL_PUNCTUATOR, source, start, 2);
+                        p = start + 2;
                     } else {
-                        source_unget_char(source, next_char);
-
-                        token->kind = TOKEN_KIND_PUNCTUATOR;
-                        token->span.offset = span_start;
-                        token->span.length = 1;
-                        token->span.position.line = span_line;
-                        token->span.position.column = span_column;
+                        set_token(token, TOKEN_KIND_PUNCTUATOR, source, start, 1);
+                        p = start + 1;
                     }
-                }
-                break;
-            case '!':
-                {
-                    int next_char = source_get_char(source);
-
-                    if (next_char == '=') {
-                        token->kind = TOKEN_KIND_NOT_EQUAL_PUNCTUATOR;
-                        token->span.offset = span_start;
-                        token->span.length = 2;
-                        token->span.position.line = span_line;
-                        token->span.position.column = span_column;
+                    break;
+                case '!':
+                    if (p[1] == '=') {
+                        set_token(token, TOKEN_KIND_NOT_EQUAL_PUNCTUATOR, source, start, 2);
+                        p = start + 2;
                     } else {
-                        source_unget_char(source, next_char);
-
-                        token->kind = TOKEN_KIND_PUNCTUATOR;
-                        token->span.offset = span_start;
-                        token->span.length = 1;
-                        token->span.position.line = span_line;
-                        token->span.position.column = span_column;
+                        set_token(token, TOKEN_KIND_PUNCTUATOR, source, start, 1);
+                        p = start + 1;
                     }
-                }
-                break;
-            case '+':
-            case '-':
-            case '*':
-            case '(':
-            case ')':
-            case '{':
-            case '}':
-            case ';':
-            case '>':
-            case '<':
-            case ',':
-                token->kind = TOKEN_KIND_PUNCTUATOR;
-                token->span.offset = span_start;
-                token->span.length = 1;
-                token->span.position.line = span_line;
-                token->span.position.column = span_column;
-                break;
-            default:
-                token->kind = TOKEN_KIND_UNKNOWN_CHARACTER;
-                token->span.offset = span_start;
-                token->span.length = 1;
-                token->span.position.line = span_line;
-                token->span.position.column = span_column;
+                    break;
+                case '.':
+                    if (char_class_of(p[1]) & CHAR_CLASS_DIGIT) {
+                        p = read_number(ctx, source, token, start);
+                        break;
+                    }
+                    set_token(token, TOKEN_KIND_UNKNOWN_CHARACTER, source, start, 1);
+                    p = start + 1;
+                    break;
+                default:
+                    set_token(token, TOKEN_KIND_UNKNOWN_CHARACTER, source, start, 1);
+                    p = start + 1;
+            }
         }
 
+        if (p != NULL) {
+            source->cursor = (size_t)(p - content);
+        }
         return;
     }
 }
 
-void read_number(struct tokenizer_context * ctx, struct source * source, struct token * token, int ch, uint32_t span_start, uint32_t span_line, uint32_t span_column)
+const char * read_number(struct tokenizer_context * ctx, struct source * source, struct token * token, const char * start)
 {
     assert(ctx != NULL);
     assert(source != NULL);
     assert(token != NULL);
+    assert(start != NULL);
 
-    for (;;) {
-        ch = source_get_char(source);
+    const char * p = start + 1;
 
-        if (!isdigit(ch) && ch != '.') {
-            if (ch == 'u' || ch == 'U') {
-                token->flags |= TOKEN_FLAG_IS_UNSIGNED;
-            } else {
-                if (ch != EOF) source_unget_char(source, ch);
-            }
-            break;
-        }
+    while ((char_class_of(*p) & CHAR_CLASS_DIGIT) || *p == '.') {
+        ++p;
     }
 
-    token->kind = TOKEN_KIND_NUMBER;
-    token->span.offset = span_start;
-    token->span.length = (uint32_t)(source->cursor - span_start);
-    token->span.position.line = span_line;
-    token->span.position.column = span_column;
-
-    const char * ptr = source->content + span_start;
-    for (uint32_t i = 0; i < token->span.length; ++i) {
-        if (ptr[i] == 'u' || ptr[i] == 'U') {
-            continue;
-        }
+    if (*p == 'u' || *p == 'U') {
+        token->flags |= TOKEN_FLAG_IS_UNSIGNED;
+        ++p;
+    }
 
-        if (ptr[i] == '.') {
-            cclynx_fatal_error("ERROR: float literals are not supported\n");
-        }
+    if (memchr(start, '.', (size_t)(p - start)) != NULL) {
+        set_error_token(ctx, token, "ERROR: float literals are not supported\n");
+        return NULL;
     }
+
+    set_token(token, TOKEN_KIND_NUMBER, source, start, (uint32_t)(p - start));
+
+    return p;
 }
 
-void read_identifier(struct tokenizer_context * ctx, struct source * source, struct token * token, int ch, uint32_t span_start, uint32_t span_line, uint32_t span_column)
+const char * read_identifier(struct tokenizer_context * ctx, struct source * source, struct token * token, const char * start)
 {
     assert(ctx != NULL);
     assert(source != NULL);
     assert(token != NULL);
+    assert(start != NULL);
 
-    do {
-        ch = source_get_char(source);
+    const char * p = start + 1;
+
+    while (char_class_of(*p) & CHAR_CLASS_IDENTIFIER) {
+        ++p;
     }
-    while(ch != EOF && (is_identifier_char(ch) || isdigit(ch)));
-    if (ch != EOF) source_unget_char(source, ch);
 
-    token->span.offset = span_start;
-    token->span.length = (uint32_t)(source->cursor - span_start);
-    token->span.position.line = span_line;
-    token->span.position.column = span_column;
+    uint32_t len = (uint32_t)(p - start);
 
-    const char * ptr = source->content + span_start;
-    uint32_t len = token->span.length;
+    set_token(token, TOKEN_KIND_IDENTIFIER, source, start, len);
 
-    struct identifier * identifier = identifier_lookup(ctx->identifier_table, ptr, len);
+    const struct identifier * keyword = keyword_lookup(start, len);
 
-    if (identifier == NULL) {
-        identifier = identifier_insert(ctx->identifier_table, ctx->pool, ptr, len);
-    }
+    /* the parser refuses keywords before attaching a symbol, so nothing is ever written through a keyword token */
+    token->identifier = keyword != NULL ? (struct identifier *)keyword : identifier_intern(ctx->identifier_table, ctx->pool, start, len);
 
-    token->kind = TOKEN_KIND_IDENTIFIER;
-    token->identifier = identifier;
+    return p;
 }
 
+
+
 const char * token_stringify(const struct token * token)
 {
     assert(token != NULL);
 
-    static char buffer[256];
+    static _Thread_local char buffer[256];
 
     if (token == &eos_token) {
         return "end of file";
@@ -299,33 +347,27 @@ const char * token_stringify(const struct token * token)
     }
 }
 
-void skip_single_line_comment(struct tokenizer_context * ctx, struct source * source)
+const char * skip_whitespace(struct source * source, const char * p, const char * end)
 {
-    assert(ctx != NULL);
-    (void)ctx;
-    int ch;
-    do {
-        ch = source_get_char(source);
-    } while (ch != '\n' && ch != EOF);
+    assert(source != NULL);
+    assert(p != NULL);
+
+    /* content[size] is '\0', which has no class, so no bounds check is needed */
+    for (int i = 0; i < SHORT_WHITESPACE_RUN; ++i, ++p) {
+        if (!(char_class_of(*p) & CHAR_CLASS_SPACE)) {
+            return p;
+        }
+    }
+
+    return scan_skip_whitespace(p, end);
 }
 
-void skip_multi_line_comment(struct tokenizer_context * ctx, struct source * source)
+const char * skip_multi_line_comment(struct source * source, const char * p, const char * end)
 {
-    assert(ctx != NULL);
-    (void)ctx;
-    for (;;) {
-        int ch = source_get_char(source);
+    assert(source != NULL);
+    assert(p != NULL);
 
-        if (ch == EOF) {
-            cclynx_fatal_error("ERROR: unterminated comment\n");
-        }
+    const char * comment_end = scan_find_comment_end(p, end);
 
-        if (ch == '*') {
-            int next = source_get_char(source);
-            if (next == '/') {
-                return;
-            }
-            source_unget_char(source, next);
-        }
-    }
+    return comment_end != NULL ? comment_end + 2 : NULL;
 }
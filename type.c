@@ -1,7 +1,6 @@
 #include <assert.h>
 
 #include "type.h"
-#include "error.h"
 
 struct type type_void = {TYPE_KIND_VOID, 0, 0, 0};
 struct type type_sint32 = {TYPE_KIND_INTEGER, 4, 4, TYPE_MODIFIER_SIGNED};
@@ -24,13 +23,14 @@ const char * type_stringify(const struct type * type)
     }
 }
 
+/* NULL when the types do not mix, the caller reports it */
 struct type * type_resolve(struct type * lhs, const struct type * rhs)
 {
     assert(lhs != NULL);
     assert(rhs != NULL);
 
     if (lhs->kind != rhs->kind) {
-        cclynx_fatal_error("ERROR: type mismatch between '%s' and '%s'\n", type_stringify(lhs), type_stringify(rhs));
+        return NULL;
     }
     return lhs;
 }